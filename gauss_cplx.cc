@@ -13,6 +13,17 @@
 #include <map>
 #include <bitset>
 #include <climits>
+#include <cerrno>
+#include <cfloat>
+#include <complex>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #ifdef _DEBUG_MODE_
 #define db(X) { cerr << "* DEBUG [L" << __LINE__ << "]: " << #X << " = " << X << endl; }
@@ -43,9 +54,12 @@ typedef unsigned int uint;
 typedef unsigned long ulong;
 typedef long double ld;
 
+void parseArgs(int argc, char **argv);
 void _main();
 
-int main() {
+int main(int argc, char **argv) {
+  parseArgs(argc, argv);
+
   // COUNTER CODE STARTS HERE
 
   _main();
@@ -57,391 +71,1541 @@ int main() {
 
 // ACTUAL CODE STARTS BELOW
 
-class Frac {
+// Instrumentation, compiled in with -DGAUSS_STATS. Counters and phase
+// timers are per thread; a thread folds them into statsTotal when it
+// exits, so batch workers never share a cache line. Without GAUSS_STATS
+// every STAT* macro is a no-op.
+#ifdef GAUSS_STATS
+struct Stats {
+  ull gcdCalls, lcmCalls, fracOps, overflows, pivots, rowsTouched, gemmMuls;
+  double parseTime, solveTime, printTime, gemmTime;
+
+  Stats() { clear(); }
+  ~Stats();
+
+  void clear() {
+    gcdCalls = lcmCalls = fracOps = overflows = pivots = rowsTouched = gemmMuls = 0;
+    parseTime = solveTime = printTime = gemmTime = 0;
+  }
+
+  void merge(const Stats &s) {
+    gcdCalls += s.gcdCalls; lcmCalls += s.lcmCalls; fracOps += s.fracOps;
+    overflows += s.overflows; pivots += s.pivots; rowsTouched += s.rowsTouched;
+    gemmMuls += s.gemmMuls;
+    parseTime += s.parseTime; solveTime += s.solveTime; printTime += s.printTime;
+    gemmTime += s.gemmTime;
+  }
+};
+
+Stats statsTotal;
+mutex statsLock;
+thread_local Stats statsLocal;
+
+Stats::~Stats() {
+  if (this == &statsTotal) return;
+  lock_guard<mutex> lock(statsLock);
+  statsTotal.merge(*this);
+}
+
+// Adds the monotonic time of its scope to one of the Stats timers.
+class StatsTimer {
 public:
-  ll num, den;
-  Frac(const int a = 0, const int b = 1) { num = a; den = b; simp(); }
+  StatsTimer(double &acc) : acc(acc), start(chrono::steady_clock::now()) {}
+  ~StatsTimer() { acc += chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+private:
+  double &acc;
+  chrono::steady_clock::time_point start;
+};
+
+#define STAT(field, n) (statsLocal.field += (n))
+#define STAT_TIMER(field) StatsTimer __statsTimer(statsLocal.field)
+#else
+#define STAT(field, n) ((void)0)
+#define STAT_TIMER(field)
+#endif
+
+// The scalar types live in templates/, with the Stats counters hooked in.
+#define RATIONAL_COUNT(event) STAT(event, 1)
+#include "templates/bigint.h"
+#include "templates/rational.h"
+#include "templates/cplx.h"
 
-  inline const Frac & operator+=(const Frac &rhs) {
-    ll m = lcm(den, rhs.den);
-    num = m/den*num + m/rhs.den*rhs.num;
-    den = m;
-    simp();
-    return *this;
+typedef Rational<int64_t> Frac;
+typedef Complex<Frac> Cplx;
+
+// Wider scalars for --width. The input is still read at 64 bits, only the
+// elimination runs at the wider type.
+typedef Complex< Rational<__int128> > Cplx128;
+typedef Complex< Rational<BigInt> > CplxBig;
+
+typedef __int128 lll;
+
+// Running sum of Frac products in __int128, normalized once by get()
+// instead of after every operation. Numerators are never reduced on the
+// way and denominators only merge through their gcd when they differ.
+// ok drops to false when an intermediate overflows.
+class FracAcc {
+public:
+  lll num, den;
+  bool ok;
+
+  FracAcc(const Frac &a = 0) : num(a.num), den(a.den), ok(true) {}
+
+  // += x * y, or -= x * y when neg is set.
+  inline void addProd(const Frac &x, const Frac &y, bool neg = false) {
+    if (!ok || !x.num || !y.num) return;
+    STAT(fracOps, 1);
+    lll p = (lll)x.num * y.num, q = (lll)x.den * y.den;
+    if (neg) p = -p;
+
+    if (q != den) {
+      lll g = int_gcd(q, den);
+      ok = !__builtin_mul_overflow(num, q / g, &num) &&
+	!__builtin_mul_overflow(p, den / g, &p) &&
+	!__builtin_mul_overflow(den / g, q, &den);
+    }
+    ok = ok && !__builtin_add_overflow(num, p, &num);
   }
 
-  inline const Frac operator+(const Frac &rhs) const {
-    Frac result(*this);
-    return result += rhs;;
+  // Writes the reduced result to r; false if it does not fit in 64 bits,
+  // and the caller redoes the operation with the Frac operators.
+  inline bool get(Frac &r) const {
+    if (!ok) return false;
+    lll g = int_gcd(num, den), n = num / g, d = den / g;
+    if (n < LLONG_MIN || n > LLONG_MAX || d > LLONG_MAX) return false;
+    r.num = n; r.den = d;
+    return true;
   }
+};
 
-  inline const Frac & operator-=(const Frac &rhs) {
-    ll m = lcm(den, rhs.den);
-    num = m/den*num - m/rhs.den*rhs.num;
-    den = m;
-    simp();
-    return *this;
+// Row kernels. rowScale multiplies by a precomputed inverse, rowAxpy does
+// a[j] -= scale * b[j] in place. Both evaluate each component through a
+// FracAcc, and fall back to the Cplx operators on overflow.
+inline void rowScale(Cplx *a, const Cplx &inv, int n) {
+  Frac re, im;
+  for (int j = 0; j < n; ++j) {
+    if (a[j].isZero()) continue;
+    FracAcc r, i;
+    r.addProd(a[j].real, inv.real); r.addProd(a[j].imag, inv.imag, true);
+    i.addProd(a[j].real, inv.imag); i.addProd(a[j].imag, inv.real);
+    if (r.get(re) && i.get(im)) {
+      a[j].real = re; a[j].imag = im;
+    } else {
+      a[j] *= inv;
+    }
   }
+}
 
-  inline const Frac operator-(const Frac &rhs) const {
-    Frac result(*this);
-    return result -= rhs;
+inline bool cplxAxpy(Cplx &a, const Cplx &b, const Cplx &scale) {
+  Frac re, im;
+  FracAcc r(a.real), i(a.imag);
+  r.addProd(scale.real, b.real, true); r.addProd(scale.imag, b.imag);
+  i.addProd(scale.real, b.imag, true); i.addProd(scale.imag, b.real, true);
+  if (!r.get(re) || !i.get(im)) return false;
+  a.real = re; a.imag = im;
+  return true;
+}
+
+inline void rowAxpy(Cplx *a, const Cplx *b, const Cplx &scale, int n) {
+  for (int j = 0; j < n; ++j) {
+    if (b[j].isZero()) continue;
+    if (!cplxAxpy(a[j], b[j], scale)) a[j] -= scale * b[j];
   }
+}
 
-  inline const Frac & operator*=(const Frac &rhs) {
-    num *= rhs.num;
-    den *= rhs.den;
-    simp();
-    return *this;
+// The same kernels on the plain operators, for the --width scalars.
+template <class S>
+inline void rowScale(S *a, const S &inv, int n) {
+  for (int j = 0; j < n; ++j) {
+    if (!a[j].isZero()) a[j] *= inv;
   }
+}
 
-  inline const Frac operator*(const Frac &rhs) const {
-    Frac result(*this);
-    return result *= rhs;
+template <class S>
+inline bool cplxAxpy(S &a, const S &b, const S &scale) {
+  a -= scale * b;
+  return true;
+}
+
+template <class S>
+inline void rowAxpy(S *a, const S *b, const S &scale, int n) {
+  for (int j = 0; j < n; ++j) {
+    if (!b[j].isZero()) a[j] -= scale * b[j];
   }
+}
+
+// Sparse rows hold (column, value) pairs sorted by column; zeros are never stored.
+template <class S>
+using SparseRow = vector< pair<int, S> >;
 
-  inline const Frac & operator/=(const Frac &rhs) {
-    assert(rhs.num);
-    num *= rhs.den;
-    den *= rhs.num;
-    simp();
-    return *this;
+template <class S>
+inline bool sparseColumnLess(const pair<int, S> &a, const pair<int, S> &b) {
+  return a.first < b.first;
+}
+
+// a -= scale * b, merging the two sorted rows and dropping cancelled entries.
+template <class S>
+void sparseSubtract(SparseRow<S> &a, const SparseRow<S> &b, const S &scale) {
+  STAT(rowsTouched, 1);
+  SparseRow<S> r;
+  r.reserve(a.size() + b.size());
+  size_t i = 0, j = 0;
+
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+      r.push_back(a[i++]);
+    } else if (i == a.size() || b[j].first < a[i].first) {
+      r.push_back(make_pair(b[j].first, S() - scale*b[j].second));
+      ++j;
+    } else {
+      S v = a[i].second;
+      if (!cplxAxpy(v, b[j].second, scale)) v -= scale*b[j].second;
+      if (!v.isZero()) r.push_back(make_pair(a[i].first, v));
+      ++i; ++j;
+    }
   }
 
-  inline const Frac operator/(const Frac &rhs) const {
-    Frac result(*this);
-    return result /= rhs;
+  a.swap(r);
+}
+
+template <class S>
+void sparseDivide(SparseRow<S> &a, const S &scale) {
+  S inv = scale.inverse();
+  for (size_t i = 0; i < a.size(); ++i) rowScale(&a[i].second, inv, 1);
+}
+
+// Pivot structure (rank and pivot columns) over GF(MOD). MOD % 4 == 1, so
+// i maps to a square root of -1 and Q(i) -> GF(MOD) is a ring homomorphism
+// for every entry whose denominators are not multiples of MOD. The rank can
+// only drop under it, which happens with probability about rank/MOD.
+const ll MOD = 998244353;
+
+ll powMod(ll b, ll e) {
+  ll r = 1;
+  b %= MOD; if (b < 0) b += MOD;
+  for (; e; e >>= 1, b = b * b % MOD) {
+    if (e & 1) r = r * b % MOD;
+  }
+  return r;
+}
+
+// Returns false when the denominator vanishes mod MOD.
+bool fracMod(const Frac &f, ll &v) {
+  ll d = f.den % MOD;
+  if (!d) return false;
+  v = (f.num % MOD + MOD) % MOD;
+  if (d != 1) v = v * powMod(d, MOD-2) % MOD;
+  return true;
+}
+
+typedef complex<double> cd;
+
+// a -= scale * b over n entries. Written on the interleaved doubles
+// instead of complex<double>::operator* (which goes through the NaN
+// checks of __muldc3) so that the loop vectorizes.
+inline void floatAxpy(cd *__restrict a, const cd *__restrict b, const cd scale, int n) {
+  double *x = reinterpret_cast<double *>(a);
+  const double *y = reinterpret_cast<const double *>(b);
+  const double sr = scale.real(), si = scale.imag();
+  for (int j = 0; j < n; ++j) {
+    const double yr = y[2*j], yi = y[2*j+1];
+    x[2*j] -= sr * yr - si * yi;
+    x[2*j+1] -= sr * yi + si * yr;
   }
+}
+
+inline void floatScale(cd *a, const cd scale, int n) {
+  double *x = reinterpret_cast<double *>(a);
+  const double sr = scale.real(), si = scale.imag();
+  for (int j = 0; j < n; ++j) {
+    const double xr = x[2*j], xi = x[2*j+1];
+    x[2*j] = sr * xr - si * xi;
+    x[2*j+1] = sr * xi + si * xr;
+  }
+}
+
+const string floatStr(const cd &v) {
+  char buf[64];
+  if (v.real() == 0 && v.imag() == 0) return "0";
+  if (v.imag() == 0) {
+    sprintf(buf, "%.6g", v.real());
+  } else if (v.real() == 0) {
+    sprintf(buf, "%.6gi", v.imag());
+  } else {
+    sprintf(buf, "%.6g%+.6gi", v.real(), v.imag());
+  }
+  return buf;
+}
 
-  inline const bool operator<(const Frac &rhs) const {
-    return num * rhs.den < den * rhs.num;
+// Fields for the blocked PLE engine below. Each one provides the scalar
+// type T, pivot choice (which may adapt the field, as FloatField does with
+// its tolerance) and the two kernels the engine is built on:
+// axpy (x -= s * y) and gemm (C -= A * B, A packed with lda columns).
+
+// GF(MOD) on 32-bit residues. Products are < 2^60, so gemm sums LAZY of
+// them in a ull and then folds the high word back in with 2^32 = R32
+// (mod MOD), which vectorizes unlike a division. The one real reduction
+// happens when a k-block is written back. Each product row of acc goes
+// through L1 once per k, a load and a store next to every vector multiply,
+// so the vectorized kernel stays well below the multiplier peak.
+struct ModField {
+  typedef uint32_t T;
+  static const ull R32 = (1ULL << 32) % MOD;
+  static const ull FOLDED = 0xFFFFFFFFULL * R32 + 0xFFFFFFFFULL;
+  static const ull LAZY = (~0ULL - FOLDED) / ((ull)(MOD-1) * (MOD-1));
+
+  inline bool isZero(T x) const { return !x; }
+  inline T mul(T a, T b) const { return (ull)a * b % MOD; }
+  inline T inv(T a) const { return powMod(a, MOD-2); }
+
+  // First nonzero entry of the column.
+  int pivot(const T *col, int ld, int r0, int r1) const {
+    for (int i = r0; i < r1; ++i) {
+      if (col[(size_t)i*ld]) return i;
+    }
+    return -1;
   }
 
-  inline const bool operator>(const Frac &rhs) const {
-    return num * rhs.den > den * rhs.num;
+  inline void axpy(T *__restrict x, const T *__restrict y, T s, int n) const {
+    const uint32_t t = MOD - s;
+    for (int j = 0; j < n; ++j) x[j] = (x[j] + (ull)t * y[j]) % MOD;
   }
 
-  inline const bool operator==(const Frac &rhs) const {
-    return llabs(num * rhs.den - den * rhs.num) < 1e-6;
+  void gemm(T *c, int ldc, const T *a, int lda, const T *b, int ldb, int m, int n, int k) const {
+    const int NB = 256, KB = 128;
+    ull acc[NB];
+    int i, j, jb, kb, kk, nb, kn;
+    ull lazy;
+
+    for (jb = 0; jb < n; jb += NB) {
+      nb = min(NB, n - jb);
+      for (kb = 0; kb < k; kb += KB) {
+	kn = min(KB, k - kb);
+	For (i, m) {
+	  const T *ai = a + (size_t)i*lda + kb;
+	  For (j, nb) acc[j] = 0;
+	  lazy = 0;
+	  For (kk, kn) {
+	    const uint32_t s = ai[kk];
+	    if (!s) continue;
+	    const T *bk = b + (size_t)(kb+kk)*ldb + jb;
+	    For (j, nb) acc[j] += (ull)s * bk[j];
+	    if (++lazy == LAZY) {
+	      For (j, nb) acc[j] = (acc[j] >> 32) * R32 + (acc[j] & 0xFFFFFFFFULL);
+	      lazy = 0;
+	    }
+	  }
+	  T *ci = c + (size_t)i*ldc + jb;
+	  For (j, nb) ci[j] = (ci[j] + MOD - acc[j] % MOD) % MOD;
+	}
+      }
+    }
   }
+};
+
+// complex<double> with partial pivoting by largest magnitude. Entries at
+// most rel * scale in norm never become pivots, where scale starts at
+// ||A||_inf and follows the largest pivot taken, since the rounding error
+// left in the trailing rows grows with the pivots.
+struct FloatField {
+  typedef cd T;
+  double rel;
+  double scale, tol2;
+
+  FloatField(double rel, double scale) : rel(rel), scale(scale), tol2(rel * scale * rel * scale) {}
+
+  double tol() const { return sqrt(tol2); }
 
-  inline const bool operator!=(const Frac &rhs) const {
-    return llabs(num * rhs.den - den * rhs.num) >= 1e-6;
+  inline bool isZero(const T &x) const { return x.real() == 0 && x.imag() == 0; }
+  inline T mul(const T &a, const T &b) const {
+    return T(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+  }
+  inline T inv(const T &a) const { return 1.0 / a; }
+
+  int pivot(const T *col, int ld, int r0, int r1) {
+    int r = -1;
+    double best = tol2;
+    for (int i = r0; i < r1; ++i) {
+      double v = norm(col[(size_t)i*ld]);
+      if (v > best) { best = v; r = i; }
+    }
+    if (best > scale * scale) {
+      scale = sqrt(best);
+      tol2 = rel * scale * rel * scale;
+    }
+    return r;
   }
 
-  inline const bool operator<=(const Frac &rhs) const {
-    return num * rhs.den <= den * rhs.num;
+  inline void axpy(T *x, const T *y, const T &s, int n) const { floatAxpy(x, y, s, n); }
+
+  void gemm(T *c, int ldc, const T *a, int lda, const T *b, int ldb, int m, int n, int k) const {
+    const int NB = 128, KB = 64;
+    int i, jb, kb, kk, nb, kn;
+
+    for (jb = 0; jb < n; jb += NB) {
+      nb = min(NB, n - jb);
+      for (kb = 0; kb < k; kb += KB) {
+	kn = min(KB, k - kb);
+	For (i, m) {
+	  const T *ai = a + (size_t)i*lda + kb;
+	  T *ci = c + (size_t)i*ldc + jb;
+	  For (kk, kn) {
+	    if (!isZero(ai[kk])) floatAxpy(ci, b + (size_t)(kb+kk)*ldb + jb, ai[kk], nb);
+	  }
+	}
+      }
+    }
   }
+};
 
-  inline const bool operator>=(const Frac &rhs) const {
-    return num * rhs.den >= den * rhs.num;
+// Blocked recursive PLE decomposition A = P L E over a field F, in place
+// on a row-major rows x cols matrix; E is in row echelon form. The column
+// range is halved down to PLE_BASE columns. After the left half is reduced,
+// its pivot rows are solved against L11 (U12 = L11^-1 A12) and the rows
+// below receive the trailing update A22 -= L21 U12 as a single gemm, then
+// the right half recurses. Row swaps move whole rows, so the multipliers
+// of L, kept below each pivot in its column, follow their rows.
+const int PLE_BASE = 32;
+
+template <class F>
+class PLE {
+public:
+  typedef typename F::T T;
+  vector<int> perm, pivotCol;
+
+  PLE(F &f, T *a, int rows, int cols) : f(f), a(a), rows(rows), cols(cols) {
+    perm.resize(rows);
+    for (int i = 0; i < rows; ++i) perm[i] = i;
   }
 
-  inline const Frac & operator=(const ll &rhs) {
-    num = roundl(rhs); den = 1;
-    return *this;
+  // Returns the rank. Rows [0, rank) then hold E above and on the pivots.
+  int run() { return reduce(0, 0, cols); }
+
+private:
+  F &f;
+  T *a;
+  int rows, cols;
+
+  inline T *row(int i) { return a + (size_t)i*cols; }
+
+  int reduce(int r0, int c0, int c1) {
+    if (r0 == rows || c0 == c1) return 0;
+    if (c1 - c0 <= PLE_BASE) return base(r0, c0, c1);
+
+    int mid = c0 + (c1 - c0) / 2, first = pivotCol.size(), k1, m;
+    k1 = reduce(r0, c0, mid);
+
+    if (k1) {
+      trsm(r0, first, k1, mid, c1);
+      m = rows - r0 - k1;
+      if (m > 0) {
+	vector<T> l21;
+	packL(l21, r0 + k1, m, first, k1);
+	// --stats reports the rate of this update in field multiply-adds.
+	STAT(gemmMuls, (ull)m * (c1 - mid) * k1);
+	STAT_TIMER(gemmTime);
+	f.gemm(row(r0+k1) + mid, cols, &l21[0], k1, row(r0) + mid, cols, m, c1 - mid, k1);
+      }
+    }
+
+    return k1 + reduce(r0 + k1, mid, c1);
   }
 
-  inline const Frac operator-() const {
-    Frac result(*this);
-    result.num = -result.num;
-    return result;
+  // Copies the multipliers of pivots [first, first+k) from rows [r0, r0+m)
+  // into a dense m x k block for gemm.
+  void packL(vector<T> &l, int r0, int m, int first, int k) {
+    int i, j;
+    l.resize((size_t)m * k);
+    For (i, m) {
+      For (j, k) l[(size_t)i*k + j] = row(r0+i)[pivotCol[first+j]];
+    }
   }
 
-  inline const Frac abs() const {
-    Frac result(*this);
-    if (result.num < 0) result.num = -result.num;
-    return result;
+  // Columns [c0, c1) of the k pivot rows from r0 become L11^-1 times
+  // themselves, L11 being the unit lower triangle of pivots [first,
+  // first+k). Recursive on k, so most of the work is again gemm.
+  void trsm(int r0, int first, int k, int c0, int c1) {
+    int i, j, h = k / 2;
+
+    if (k <= PLE_BASE) {
+      ForL (i, 1, k) {
+	For (j, i) {
+	  const T l = row(r0+i)[pivotCol[first+j]];
+	  if (!f.isZero(l)) f.axpy(row(r0+i) + c0, row(r0+j) + c0, l, c1 - c0);
+	}
+      }
+      return;
+    }
+
+    trsm(r0, first, h, c0, c1);
+    vector<T> l21;
+    packL(l21, r0 + h, k - h, first, h);
+    f.gemm(row(r0+h) + c0, cols, &l21[0], h, row(r0) + c0, cols, k - h, c1 - c0, h);
+    trsm(r0 + h, first + h, k - h, c0, c1);
   }
 
-  inline ll gcd(ll a, ll b) {
-    a = llabs(a); b = llabs(b);
-    ll c;
-    while ( b >= 1e-6 ) {
-      c = a%b; a = b; b = c;
+  // Unblocked elimination restricted to columns [c0, c1).
+  int base(int r0, int c0, int c1) {
+    int c, i, p, r, k = 0;
+
+    for (c = c0; c < c1 && r0 + k < rows; ++c) {
+      r = r0 + k;
+      p = f.pivot(a + c, cols, r, rows);
+      if (p == -1) continue;
+
+      STAT(pivots, 1);
+      if (p != r) {
+	swap_ranges(row(r), row(r) + cols, row(p));
+	xchg(perm[r], perm[p]);
+      }
+
+      const T inv = f.inv(row(r)[c]);
+      ForL (i, r+1, rows) {
+	T &x = row(i)[c];
+	if (f.isZero(x)) continue;
+	x = f.mul(x, inv);
+	f.axpy(row(i) + c+1, row(r) + c+1, x, c1 - (c+1));
+      }
+
+      pivotCol.push_back(c);
+      ++k;
     }
-    return a;
+    return k;
   }
+};
 
-  inline ll lcm(const ll &a, const ll &b) {
-    ll d = gcd(a, b);
-    return llabs(a)/d*llabs(b);
+bool optSparse = false, optFloat = false, optCheck = false, optBatch = false;
+int optJobs = 0, optStats = 0;
+
+enum Mode { MODE_RREF, MODE_DET, MODE_INVERSE, MODE_RANK, MODE_NULLSPACE, MODE_SOLVE, MODE_MOD };
+int optMode = MODE_RREF;
+
+// Pivot choice of the exact eliminations. optPeak is set by --pivot and
+// makes them track the largest coefficient they produce.
+enum Pivot { PIVOT_NORM, PIVOT_HEIGHT, PIVOT_SPARSE };
+const char *pivotNames[] = { "norm", "height", "sparse" };
+int optPivot = PIVOT_NORM;
+bool optPeak = false;
+
+enum Width { WIDTH_64, WIDTH_128, WIDTH_BIG };
+const char *widthNames[] = { "64", "128", "big" };
+int optWidth = WIDTH_64;
+
+// One input matrix and everything needed to reduce it. All output goes to
+// `out`, so batch workers can each render into their own buffer. S is the
+// scalar of the exact eliminations; input is always read as Matrix<Cplx>
+// and widened for --width.
+template <class S>
+class Matrix {
+public:
+  typedef typename S::value_type F;
+
+  int rows, cols;
+  S **data;
+  FILE *out;
+  int status;
+
+  Matrix *rhs;
+
+  // Filled by factor().
+  vector<int> perm, pivotCol;
+  int swaps;
+
+  // Largest S::bits() seen so far, kept only with optPeak.
+  int peakBits;
+
+  Matrix(int r, int c, FILE *o = stdout) : rows(r), cols(c), out(o), status(0), rhs(NULL), peakBits(0) {
+    data = new S*[rows];
+    for (int i = 0; i < rows; ++i) data[i] = new S[cols];
   }
 
-  inline void simp() {
-    if (den < 0) {
-      den = -den; num = -num;
+  ~Matrix() {
+    delete rhs;
+    for (int i = 0; i < rows; ++i) delete [] data[i];
+    delete [] data;
+  }
+
+  void printData() {
+    STAT_TIMER(printTime);
+    int i, j;
+    char *c, fmt[16];
+
+    vector<int> width;
+    width.clear(); width.resize(cols);
+
+    For (i, cols) {
+      For (j, rows) {
+	width[i] = max(width[i], (int)data[j][i].str().size());
+      }
+    }
+
+    For (i, rows) {
+      For (j, cols) {
+	if (j) fprintf(out, "  ");
+	sprintf(fmt, "%%%ds", width[j]);
+	c = data[i][j].c_str();
+	fprintf(out, fmt, c);
+	free(c);
+      }
+      fputc('\n', out);
     }
 
-    ll d = gcd(num, den);
-    num = num / d;
-    den = den / d;
+    width.clear();
+    fputc('\n', out);
   }
 
-  const string str() const {
-    char * ret = c_str();
-    string result(ret);
-    free(ret);
-    return result;
+  // Swaps rows ra and rb along with their perm entries, and counts the
+  // swap for det().
+  void rowSwap(int ra, int rb, bool steps) {
+    if (ra == rb) return;
+    xchg(data[ra], data[rb]);
+    xchg(perm[ra], perm[rb]);
+    ++swaps;
+    if (!steps) return;
+    fprintf(out, ">>>>>>>>   r%d <--> r%d   <<<<<<<<\n", ra+1, rb+1);
+    printData();
   }
 
-  char * c_str() const {
-    char buf[50];
-    if (den != 1) {
-      sprintf(buf, "%Ld/%Ld", num, den);
+  void rowDivide(int r, const S scale) {
+    if (scale == S(F(1))) return;
+    if (scale == S(F(-1))) {
+      fprintf(out, "////////   -r%d   ////////\n", r+1);
     } else {
-      sprintf(buf, "%Ld", num);
+      fprintf(out, "////////   r%d/(%s)   ////////\n", r+1, scale.str().c_str());
     }
-    return strdup(buf);
+
+    rowScale(data[r], scale.inverse(), cols);
+    notePeak(r);
+    printData();
+    return;
   }
 
-  inline const long double val() const {
-    return (long double)num / den;
+  void rowSubtract(int ra, int rb, const S scale) {
+    if (scale.isZero()) return;
+    if (scale == S(F(1))) {
+      fprintf(out, "********   r%d - r%d   ********\n", ra+1, rb+1);
+    } else if (scale == S(F(-1))) {
+      fprintf(out, "********   r%d + r%d   ********\n", ra+1, rb+1);
+    } else {
+      fprintf(out, "********   r%d - (%s) x r%d   ********\n", ra+1, scale.str().c_str(), rb+1);
+    }
+
+    STAT(rowsTouched, 1);
+    rowAxpy(data[ra], data[rb], scale, cols);
+    notePeak(ra);
+    //printData();
+
+    return;
   }
-};
 
-class Cplx {
-public:
-  Frac real, imag;
-  Cplx(const Frac &r=0, const Frac &i=0) { real = r; imag = i; }
-  Cplx(const Cplx &v) { real = v.real; imag = v.imag; }
-  inline const Cplx conj() const { return Cplx(real, -imag); }
-  inline const Frac normSqr() const { return real * real + imag * imag; }
-  inline const long double norm() const { long double a = real.val(), b = imag.val(); return a*a+b*b; }
+  // Row in [pr, rows) holding the nonzero entry of column pc that costs
+  // least under optPivot, or -1 if that part of the column is zero. Ties
+  // go to the topmost row.
+  //   norm    smallest norm of the entry
+  //   height  smallest bit height of the entry, so the pivot row spreads
+  //           the shortest numerators and denominators into the others
+  //   sparse  fewest nonzeros left in the row, so each update touches
+  //           (and grows) the fewest entries
+  int findPivot(int pr, int pc) {
+    int i, j, r = -1;
+    long double cost, minCost = 0;
 
-  inline const Cplx & operator+=(const Cplx & rhs) {
-    real += rhs.real; imag += rhs.imag;
-    return *this;
+    ForL (i, pr, rows) {
+      if (data[i][pc].isZero()) continue;
+      switch (optPivot) {
+      case PIVOT_HEIGHT:
+	cost = data[i][pc].bits();
+	break;
+      case PIVOT_SPARSE:
+	cost = 0;
+	ForL (j, pc+1, cols) cost += !data[i][j].isZero();
+	break;
+      default:
+	cost = data[i][pc].norm();
+      }
+      if (r == -1 || minCost > cost) {
+	minCost = cost;
+	r = i;
+      }
+    }
+    return r;
+  }
+
+  // Called on every row that an elimination step changes, so the peak
+  // costs one pass over the touched rows instead of the whole matrix.
+  void notePeak(int r) {
+    int j;
+    if (!optPeak) return;
+    For (j, cols) peakBits = max(peakBits, data[r][j].bits());
   }
 
-  inline const Cplx & operator-=(const Cplx & rhs) {
-    real -= rhs.real; imag -= rhs.imag;
-    return *this;
+  void printPeak() {
+    if (optPeak) fprintf(out, "Peak coefficient size: %d bits (pivot=%s)\n", peakBits, pivotNames[optPivot]);
   }
 
-  inline const Cplx & operator*=(const Cplx & rhs) {
-    *this = Cplx(real * rhs.real - imag * rhs.imag, real * rhs.imag + imag * rhs.real);
-    return *this;
+  void rrefStep() {
+    fprintf(out, "******   ORIGINAL CONFIGURATION   ******\n");
+    printData();
+    eliminate(true);
   }
 
-  inline const Cplx & operator/=(const Cplx & rhs) {
-    Cplx c = rhs.conj(); Frac t = rhs.normSqr();
-    *this *= c;
-    real /= t;
-    imag /= t;
-    return *this;
+  // The column sweep behind rrefStep() and factor(). Every column that
+  // still has a nonzero at or below row pr gets its pivot from
+  // findPivot(), swapped up to row pr. With steps, the pivot row is
+  // divided by the pivot and the column cleared in all other rows, with
+  // each operation printed, which leaves the RREF. Otherwise only the
+  // rows below are cleared and keep their multipliers, as in factor().
+  void eliminate(bool steps) {
+    int i, r, pc, pr;
+
+    perm.resize(rows);
+    For (i, rows) perm[i] = i;
+    pivotCol.clear();
+    swaps = 0;
+    For (i, rows) notePeak(i);
+
+    pr = 0;
+    For (pc, cols) {
+      if (pr == rows) break;
+      r = findPivot(pr, pc);
+      if (r == -1) continue;
+
+      STAT(pivots, 1);
+      rowSwap(pr, r, steps);
+
+      if (steps) {
+	rowDivide(pr, data[pr][pc]);
+	For (r, rows) {
+	  if (r != pr) rowSubtract(r, pr, data[r][pc]);
+	}
+	printData();
+      } else {
+	S inv = data[pr][pc].inverse();
+	ForL (i, pr+1, rows) {
+	  if (data[i][pc].isZero()) continue;
+	  STAT(rowsTouched, 1);
+	  S l = data[i][pc] * inv;
+	  rowAxpy(data[i] + pc+1, data[pr] + pc+1, l, cols - (pc+1));
+	  data[i][pc] = l;
+	  notePeak(i);
+	}
+      }
+
+      pivotCol.push_back(pc);
+      ++pr;
+    }
   }
 
-  inline const Cplx operator+(const Cplx &rhs) const { Cplx r(*this); r += rhs; return r; }
-  inline const Cplx operator-(const Cplx &rhs) const { Cplx r(*this); r -= rhs; return r; }
-  inline const Cplx operator*(const Cplx &rhs) const { Cplx r(*this); r *= rhs; return r; }
-  inline const Cplx operator/(const Cplx &rhs) const { Cplx r(*this); r /= rhs; return r; }
+  // Same reduced form as rrefStep(), but only the result is displayed.
+  // Pivot columns are forced by the RREF, so the Markowitz cost
+  // (r_i - 1) * (c_j - 1) only varies with the row: among the candidates
+  // of a column we take the row with the fewest nonzeros, which bounds the
+  // fill-in of every update it causes.
+  void sparseRref() {
+    int i, j, k, pc, pr, best;
 
-  inline const bool operator==(const Cplx &rhs) const { return real == rhs.real && imag == rhs.imag; }
-  inline const bool operator==(const Frac &rhs) const { return real == rhs; }
+    fprintf(out, "******   ORIGINAL CONFIGURATION   ******\n");
+    printData();
 
-  const string str() const {
-    if (real == 0 && imag == 0) return "0";
-    string result = "";
+    vector< SparseRow<S> > sp(rows);
+    vector<int> order(rows), pivotCol;
+    For (i, rows) {
+      order[i] = i;
+      For (j, cols) {
+	if (!data[i][j].isZero()) sp[i].push_back(make_pair(j, data[i][j]));
+      }
+    }
 
-    if (real != 0) {
-      result += real.str();
+    // Forward phase: rows [0, pr) of order are pivot rows, the rest are
+    // still active and have no entries left of the current column.
+    pr = 0;
+    For (pc, cols) {
+      if (pr == rows) break;
+
+      best = -1;
+      ForL (i, pr, rows) {
+	const SparseRow<S> &row = sp[order[i]];
+	if (row.empty() || row[0].first != pc) continue;
+	if (best == -1 || row.size() < sp[order[best]].size()) best = i;
+      }
+      if (best == -1) continue;
+
+      xchg(order[pr], order[best]);
+      STAT(pivots, 1);
+      SparseRow<S> &p = sp[order[pr]];
+      sparseDivide(p, S(p[0].second));
+
+      ForL (i, pr+1, rows) {
+	SparseRow<S> &row = sp[order[i]];
+	if (!row.empty() && row[0].first == pc) {
+	  sparseSubtract(row, p, S(row[0].second));
+	}
+      }
+
+      pivotCol.push_back(pc);
+      ++pr;
     }
 
-    if (imag != 0) {
-      if (imag > 0 && result.size()) result += '+';
-      if (imag == -1)
-	result += '-';
-      else if (imag != 1) {
-	if (imag.den == 1) {
-	  result += imag.str();
-	} else {
-	  if (imag.num > 0) {
-	    result = result + "(" + imag.str() + ")";
-	  } else {
-	    result = result + "-(" + imag.abs().str() + ")";
-	  }
+    // Backward phase: clear each pivot column above its pivot.
+    for (k = pr-1; k > 0; --k) {
+      const SparseRow<S> &p = sp[order[k]];
+      For (i, k) {
+	SparseRow<S> &row = sp[order[i]];
+	typename SparseRow<S>::iterator it = lower_bound(row.begin(), row.end(),
+					     make_pair(pivotCol[k], S()), sparseColumnLess<S>);
+	if (it != row.end() && it->first == pivotCol[k]) {
+	  sparseSubtract(row, p, S(it->second));
+	}
+      }
+    }
+
+    For (i, rows) {
+      For (j, cols) data[i][j] = S();
+      const SparseRow<S> &row = sp[order[i]];
+      for (k = 0; k < (int)row.size(); ++k) data[i][row[k].first] = row[k].second;
+    }
+
+    fprintf(out, "******   REDUCED ROW ECHELON FORM   ******\n");
+    printData();
+  }
+
+  // Rank profile over GF(MOD) with the blocked PLE engine.
+  bool modPivots(vector<int> &pivotCol) {
+    int i, j;
+    ll unit = powMod(3, (MOD-1)/4), re, im;
+    vector<uint32_t> m((size_t)rows * cols);
+
+    For (i, rows) {
+      For (j, cols) {
+	if (!fracMod(data[i][j].real, re) || !fracMod(data[i][j].imag, im)) return false;
+	m[(size_t)i*cols + j] = (re + unit * im) % MOD;
+      }
+    }
+
+    ModField f;
+    PLE<ModField> ple(f, m.empty() ? NULL : &m[0], rows, cols);
+    ple.run();
+    pivotCol = ple.pivotCol;
+    return true;
+  }
+
+  // Numeric RREF with partial pivoting by largest magnitude. Entries below
+  // max(rows, cols) * DBL_EPSILON * ||A||_inf count as zero, ||A||_inf
+  // growing with the pivots (see FloatField).
+  void floatRref() {
+    int i, j, r, pc, pr;
+    vector<cd> m((size_t)rows * cols);
+    double norm = 0;
+
+    For (i, rows) {
+      double rowSum = 0;
+      For (j, cols) {
+	m[(size_t)i*cols + j] = cd(data[i][j].real.val(), data[i][j].imag.val());
+	rowSum += abs(m[(size_t)i*cols + j]);
+      }
+      norm = std::max(norm, rowSum);
+    }
+
+    // Forward phase with the blocked engine, then the echelon form is
+    // normalized and cleared upwards, last pivot first.
+    FloatField f(std::max(rows, cols) * DBL_EPSILON, norm);
+    PLE<FloatField> ple(f, m.empty() ? NULL : &m[0], rows, cols);
+    pr = ple.run();
+    const vector<int> &pivotCol = ple.pivotCol;
+
+    For (r, rows) {
+      cd *row = &m[(size_t)r*cols];
+      pc = r < pr ? pivotCol[r] : cols;
+      fill(row, row + pc, cd(0));
+      if (r < pr) {
+	floatScale(row + pc, 1.0 / row[pc], cols - pc);
+	row[pc] = 1;
+      }
+    }
+
+    for (r = pr-1; r > 0; --r) {
+      pc = pivotCol[r];
+      const cd *p = &m[(size_t)r*cols];
+      For (i, r) {
+	cd *row = &m[(size_t)i*cols];
+	if (row[pc] != cd(0)) {
+	  STAT(rowsTouched, 1);
+	  floatAxpy(row + pc, p + pc, row[pc], cols - pc);
+	  row[pc] = 0;
 	}
       }
-      result += 'i';
     }
 
-    return result;
+    double tol = f.tol();
+    For (i, (int)m.size()) {
+      m[i] = cd(fabs(m[i].real()) <= tol ? 0 : m[i].real(), fabs(m[i].imag()) <= tol ? 0 : m[i].imag());
+    }
+
+    STAT_TIMER(printTime);
+    vector<int> width(cols);
+    For (i, rows) {
+      For (j, cols) width[j] = std::max(width[j], (int)floatStr(m[(size_t)i*cols + j]).size());
+    }
+    fprintf(out, "******   NUMERIC REDUCED ROW ECHELON FORM   ******\n");
+    For (i, rows) {
+      For (j, cols) {
+	if (j) fprintf(out, "  ");
+	fprintf(out, "%*s", width[j], floatStr(m[(size_t)i*cols + j]).c_str());
+      }
+      fputc('\n', out);
+    }
+    fputc('\n', out);
+
+    fprintf(out, "Rank: %d\nPivot columns:", (int)pivotCol.size());
+    For (i, (int)pivotCol.size()) fprintf(out, " %d", pivotCol[i]+1);
+    fputc('\n', out);
+
+    if (optCheck) {
+      vector<int> exact;
+      if (!modPivots(exact)) {
+	fprintf(out, "Check: inconclusive, a denominator is divisible by %Ld.\n", MOD);
+      } else if (exact == pivotCol) {
+	fprintf(out, "Check: passed, pivot structure matches GF(%Ld).\n", MOD);
+      } else {
+	fprintf(out, "Check: FAILED, GF(%Ld) gives rank %d with pivot columns", MOD, (int)exact.size());
+	For (i, (int)exact.size()) fprintf(out, " %d", exact[i]+1);
+	fputc('\n', out);
+	status = 2;
+      }
+    }
   }
 
-  char * c_str() const {
-    return strdup(str().c_str());
+  // Silent in-place factorization P A = L U by the forward sweep of
+  // eliminate(). U is in row echelon form with its pivots in pivotCol. The
+  // multipliers of the unit lower triangular L are kept below the pivots:
+  // L[i][k] is stored in data[i][pivotCol[k]]. Row i of P A is row perm[i] of A.
+  void factor() {
+    eliminate(false);
   }
-};
 
-int cols, rows;
-Cplx **data;
+  int rank() const { return pivotCol.size(); }
 
-void printData() {
-  int i, j;
-  char *c, fmt[16];
+  // Requires factor() on a square matrix.
+  const S det() const {
+    int k;
+    if (rank() < rows) return S();
+    S d(F(swaps & 1 ? -1 : 1));
+    For (k, rows) d *= data[k][k];
+    return d;
+  }
 
-  vector<int> width;
-  width.clear(); width.resize(cols);
+  // Solves A x = b for every column of b, reusing the factorization. Each
+  // x is a particular solution with its free variables set to zero.
+  // Returns the (0-based) columns of b that are inconsistent.
+  const vector<int> solveFactored(const Matrix &b, Matrix &x) const {
+    int i, j, k, c, n = rank();
+    vector<int> bad;
+    vector<S> y(rows);
+
+    For (c, b.cols) {
+      For (i, rows) {
+	y[i] = b.data[perm[i]][c];
+	For (k, min(i, n)) {
+	  if (!data[i][pivotCol[k]].isZero()) y[i] -= data[i][pivotCol[k]] * y[k];
+	}
+      }
+
+      ForL (i, n, rows) {
+	if (!y[i].isZero()) break;
+      }
+      if (i < rows) bad.push_back(c);
 
-  For (i, cols) {
-    For (j, rows) {
-      width[i] = max(width[i], (int)data[j][i].str().size());
+      For (j, cols) x.data[j][c] = S();
+      for (k = n-1; k >= 0; --k) {
+	S v = y[k];
+	ForL (j, pivotCol[k]+1, cols) {
+	  if (!data[k][j].isZero()) v -= data[k][j] * x.data[j][c];
+	}
+	x.data[pivotCol[k]][c] = v / data[k][pivotCol[k]];
+      }
     }
+    return bad;
   }
 
-  For (i, rows) {
-    For (j, cols) {
-      if (j) printf("  ");
-      sprintf(fmt, "%%%ds", width[j]);
-      c = data[i][j].c_str();
-      printf(fmt, c);
-      free(c);
+  // Requires factor(). One basis vector per free column, stored as columns.
+  Matrix *nullspace() const {
+    int i, j, k, f = 0;
+    vector<bool> isPivot(cols);
+    For (k, rank()) isPivot[pivotCol[k]] = true;
+
+    Matrix *z = new Matrix(cols, cols - rank(), out);
+    try {
+      For (j, cols) {
+	if (isPivot[j]) continue;
+	z->data[j][f] = S(F(1));
+	for (k = rank()-1; k >= 0; --k) {
+	  S v;
+	  ForL (i, pivotCol[k]+1, cols) {
+	    if (!data[k][i].isZero()) v -= data[k][i] * z->data[i][f];
+	  }
+	  z->data[pivotCol[k]][f] = v / data[k][pivotCol[k]];
+	}
+	++f;
+      }
+    } catch (const RationalOverflow &) {
+      delete z;
+      throw;
     }
-    putchar('\n');
+    return z;
   }
 
-  width.clear();
-  putchar('\n');
-}
+  bool requireSquare(const char *what) {
+    if (rows == cols) return true;
+    fprintf(out, "The %s needs a square matrix, got %d x %d.\n", what, rows, cols);
+    status = 1;
+    return false;
+  }
 
-void rowSwap(int ra, int rb) {
-  if (ra == rb) return;
-  register int i;
-  printf(">>>>>>>>   r%d <--> r%d   <<<<<<<<\n", ra+1, rb+1);
-  For (i, cols) xchg(data[ra][i], data[rb][i]);
-  printData();
-  return;
-}
+  void printPivots() {
+    int k;
+    fprintf(out, "Rank: %d\nPivot columns:", rank());
+    For (k, rank()) fprintf(out, " %d", pivotCol[k]+1);
+    fputc('\n', out);
+  }
 
-void rowDivide(int r, const Cplx scale) {
-  if (scale == Cplx(1)) return;
-  if (scale == Cplx(-1)) {
-    printf("////////   -r%d   ////////\n", r+1);
-  } else {
-    printf("////////   r%d/(%s)   ////////\n", r+1, scale.c_str());
+  void solve() {
+    STAT_TIMER(solveTime);
+    int k;
+
+    if (optMode == MODE_MOD) {
+      vector<int> pivotCol;
+      if (!modPivots(pivotCol)) {
+	fprintf(out, "A denominator is divisible by %Ld.\n", MOD);
+	status = 1;
+	return;
+      }
+      fprintf(out, "Rank over GF(%Ld): %d\nPivot columns:", MOD, (int)pivotCol.size());
+      For (k, (int)pivotCol.size()) fprintf(out, " %d", pivotCol[k]+1);
+      fputc('\n', out);
+      return;
+    }
+
+    if (optMode == MODE_RREF && optFloat) {
+      floatRref();
+      return;
+    }
+
+    // An exact reduction that overflows its scalar is redone from the
+    // input at the next --width, up to BigInt, which cannot overflow.
+    int w;
+    for (w = optWidth; w < WIDTH_BIG; ++w) {
+      if (w == WIDTH_64 ? solveWide<Cplx>() : solveWide<Cplx128>()) return;
+      fprintf(out, "Arithmetic overflowed at %s bits, redone at %s.\n", widthNames[w],
+	      w == WIDTH_64 ? "128 bits" : "BigInt");
+    }
+    solveWide<CplxBig>();
   }
 
-  register int i;
-  For (i, cols) data[r][i] /= scale;
-  printData();
-  return;
-}
+  // Copy over another scalar type, right-hand sides included, that
+  // writes to o.
+  template <class T>
+  Matrix<T> *widen(FILE *o) const {
+    int i, j;
+    Matrix<T> *m = new Matrix<T>(rows, cols, o);
+    For (i, rows) {
+      For (j, cols) m->data[i][j] = T(data[i][j]);
+    }
+    if (rhs) m->rhs = rhs->template widen<T>(o);
+    return m;
+  }
 
-void rowSubtract(int ra, int rb, const Cplx scale) {
-  if (scale == Cplx(0,0) ) return;
-  if (scale == 1) {
-    printf("********   r%d - r%d   ********\n", ra+1, rb+1);
-  } else if (scale == -1) {
-    printf("********   r%d + r%d   ********\n", ra+1, rb+1);
-  } else {
-    printf("********   r%d - (%s) x r%d   ********\n", ra+1, scale.c_str(), rb+1);
+  // Reduces a copy at the scalar T, leaving this matrix as read. The
+  // output is held back and only reaches out if nothing overflowed;
+  // false on RationalOverflow.
+  template <class T>
+  bool solveWide() {
+    char *buf;
+    size_t len;
+    FILE *mem = open_memstream(&buf, &len);
+    Matrix<T> *m = widen<T>(mem);
+    bool ok = true;
+    try {
+      m->solveExact();
+      status = m->status;
+    } catch (const RationalOverflow &) {
+      ok = false;
+    }
+    delete m;
+    fclose(mem);
+    if (ok) fwrite(buf, 1, len, out);
+    free(buf);
+    return ok;
   }
 
-  register int i;
-  For (i, cols) data[ra][i] -= scale*data[rb][i];
-  //printData();
+  // Everything but the float and modular paths, at the scalar S.
+  void solveExact() {
+    int k;
 
-  return;
-}
+    if (optMode != MODE_RREF) {
+      factor();
+      printPeak();
+    }
+    switch (optMode) {
+    case MODE_DET:
+      if (requireSquare("determinant")) fprintf(out, "Determinant: %s\n", det().str().c_str());
+      return;
+    case MODE_RANK:
+      printPivots();
+      return;
+    case MODE_INVERSE:
+      if (!requireSquare("inverse")) return;
+      if (rank() < rows) {
+	fprintf(out, "Matrix is singular, rank %d < %d.\n", rank(), rows);
+      } else {
+	Matrix id(rows, rows, out), inv(rows, rows, out);
+	For (k, rows) id.data[k][k] = S(F(1));
+	solveFactored(id, inv);
+	fprintf(out, "******   INVERSE   ******\n");
+	inv.printData();
+      }
+      return;
+    case MODE_NULLSPACE:
+      printPivots();
+      if (rank() == cols) {
+	fprintf(out, "Nullspace: {0}\n");
+      } else {
+	Matrix *z = nullspace();
+	fprintf(out, "******   NULLSPACE BASIS (COLUMNS)   ******\n");
+	z->printData();
+	delete z;
+      }
+      return;
+    case MODE_SOLVE: {
+      Matrix x(cols, rhs->cols, out);
+      vector<int> bad = solveFactored(*rhs, x);
+      if (bad.empty()) {
+	fprintf(out, "******   SOLUTION   ******\n");
+	x.printData();
+      } else {
+	fprintf(out, "No solution for right-hand side column(s):");
+	For (k, (int)bad.size()) fprintf(out, " %d", bad[k]+1);
+	fputc('\n', out);
+      }
+      return;
+    }
+    }
 
-void rrefStep() {
-  int r, c, pr, pc, i, j;
+    if (optSparse) {
+      sparseRref();
+    } else {
+      rrefStep();
+      printPeak();
+    }
+  }
+};
 
-  printf("******   ORIGINAL CONFIGURATION   ******\n");
-  printData();
+// Whole-input reader. A regular file on stdin is mmap'ed, anything else is
+// read in large blocks into a buffer that grows to fit the longest token.
+// Tokens are parsed in place, without copies or fixed-size buffers.
+class Input {
+public:
+  Input(int fd = 0) : fd(fd), mapped(false), eof(false) {
+    struct stat st;
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m != MAP_FAILED) {
+	madvise(m, st.st_size, MADV_SEQUENTIAL);
+	buf = (char *)m; cap = st.st_size;
+	p = buf; end = buf + cap;
+	mapped = eof = true;
+	return;
+      }
+    }
+    cap = 1 << 20;
+    buf = (char *)malloc(cap);
+    p = end = buf;
+  }
 
-  pc = 0;
+  ~Input() {
+    if (mapped) munmap(buf, cap); else free(buf);
+  }
 
-  For (pr, rows) {
-    Cplx max(0); r = -1;
-    long double maxNorm = 0;
+  bool readInt(int &v) {
+    char *e = token();
+    if (!e) return false;
+    ll x;
+    const char *s = p;
+    bool neg = s < e && *s == '-';
+    if (neg || (s < e && *s == '+')) ++s;
+    if (!parseNum(s, e, x) || s != e || x > INT_MAX) return false;
+    v = neg ? -x : x;
+    p = e;
+    return true;
+  }
 
-    ForL (i, pr, rows) {
-      if (data[i][pc].normSqr() == 0) continue;
-      if (r == -1 || maxNorm > data[i][pc].norm()) {
-	max = data[i][pc];
-	maxNorm = max.norm();
-	r = i;
+  // Entries are sums of terms [+-][num[/den]][i], the coefficient of an
+  // imaginary term may be parenthesized as printed by Cplx::str().
+  bool readCplx(Cplx &v) {
+    char *e = token();
+    if (!e) return false;
+    const char *s = p;
+    ll a, b;
+    bool neg, paren, digits;
+
+    v = Cplx(0, 0);
+    if (s == e) return false;
+    while (s < e) {
+      neg = *s == '-';
+      if (neg || *s == '+') ++s;
+      paren = s < e && *s == '(';
+      if (paren) ++s;
+
+      a = b = 1;
+      digits = s < e && '0' <= *s && *s <= '9';
+      if (digits) {
+	if (!parseNum(s, e, a)) return false;
+	if (s < e && *s == '/' && (!parseNum(++s, e, b) || !b)) return false;
+      }
+      if (paren && (!digits || s == e || *(s++) != ')')) return false;
+      if (neg) a = -a;
+
+      if (s < e && *s == 'i') {
+	++s;
+	v.imag = Frac(a, b);
+      } else if (digits && !paren) {
+	v.real = Frac(a, b);
+      } else {
+	return false;
       }
+      if (s < e && *s != '+' && *s != '-') return false;
     }
 
-    if (r == -1) {
-      --pr; ++pc;
-      if (pc == cols) break;
-      continue;
+    p = e;
+    return true;
+  }
+
+  bool atEnd() { return !token(); }
+
+  // The current (unconsumed) token, for error messages.
+  const string current() {
+    char *e = token();
+    return e ? string(p, e) : string("<end of input>");
+  }
+
+private:
+  int fd;
+  char *buf, *p, *end;
+  size_t cap;
+  bool mapped, eof;
+
+  static inline bool isSpace(char c) { return c == ' ' || ('\t' <= c && c <= '\r'); }
+
+  // Unsigned decimal; fails on no digits or on overflow.
+  static bool parseNum(const char *&s, const char *e, ll &v) {
+    if (s == e || *s < '0' || *s > '9') return false;
+    for (v = 0; s < e && '0' <= *s && *s <= '9'; ++s) {
+      if (__builtin_mul_overflow(v, 10, &v) || __builtin_add_overflow(v, *s - '0', &v)) return false;
     }
+    return true;
+  }
 
-    rowSwap(pr, r);
-    rowDivide(pr, max);
+  // Skips whitespace and returns the end of the next token, which is then
+  // entirely in [p, end). Returns NULL at end of input.
+  char *token() {
+    for (;;) {
+      while (p < end && isSpace(*p)) ++p;
+      char *q = p;
+      while (q < end && !isSpace(*q)) ++q;
+      if (q < end || eof) return p < end ? q : NULL;
+      refill();
+    }
+  }
 
-    For (r, rows) {
-      if (r != pr) {
-	rowSubtract(r, pr, data[r][pc]);
+  void refill() {
+    size_t keep = end - p;
+    if (p != buf) memmove(buf, p, keep);
+    if (keep == cap) buf = (char *)realloc(buf, cap *= 2);
+    p = buf; end = buf + keep;
+
+    ssize_t n;
+    do {
+      n = read(fd, end, cap - keep);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) eof = true; else end += n;
+  }
+};
+
+// Reads the next "rows cols" header and its entries. Returns NULL at end
+// of input, or on invalid data with the reason in error.
+Matrix<Cplx> *readBlock(Input &in, string &error) {
+  int rows, cols, i, j;
+  if (!in.readInt(rows)) {
+    if (!in.atEnd()) error = "Invalid input data, expected rows, got \"" + in.current() + "\".";
+    return NULL;
+  }
+  if (!in.readInt(cols) || rows < 0 || cols < 0) {
+    error = "Invalid input data, expected cols, got \"" + in.current() + "\".";
+    return NULL;
+  }
+
+  Matrix<Cplx> *m = new Matrix<Cplx>(rows, cols);
+
+  For (i, rows) {
+    For (j, cols) {
+      if (!in.readCplx(m->data[i][j])) {
+	error = "Invalid input data, entry (" + to_string(i+1) + ", " + to_string(j+1) + ") = \"" + in.current() + "\".";
+	delete m;
+	return NULL;
       }
     }
-    printData();
+  }
 
-    ++pc;
-    if (pc == cols) break;
+  return m;
+}
+
+// One problem of the input: the matrix A and, for --solve, the right-hand
+// sides B that follow it, one per column. Errors are as for readBlock().
+Matrix<Cplx> *readMatrix(Input &in, string &error) {
+  STAT_TIMER(parseTime);
+  Matrix<Cplx> *m = readBlock(in, error);
+
+  if (m && optMode == MODE_SOLVE) {
+    m->rhs = readBlock(in, error);
+    if (!m->rhs || m->rhs->rows != m->rows) {
+      if (error.empty()) error = "Invalid input data, expected a right-hand side matrix with " + to_string(m->rows) + " rows.";
+      delete m;
+      return NULL;
+    }
   }
+  return m;
 }
 
-void _main() {
-  char buf[64], tok[64];
-  cin >> rows >> cols;
+// Batch mode: the main thread parses matrices and hands them to a pool of
+// workers, each rendering into its own memory stream. Finished results are
+// written strictly in input order; at most 4 jobs per worker are in flight.
+// Invalid data ends the input: the matrices before it are still solved
+// and written, then the error, and the status is 1.
+struct BatchJob {
+  Matrix<Cplx> *m;
+  char *buf;
+  size_t len;
+  bool done;
+};
 
-  int i, j, r, s, v;
-  ll a, b;
+mutex batchLock;
+condition_variable batchReady, batchDone;
+queue<BatchJob *> batchTodo;
+bool batchEof = false;
+
+void batchWorker() {
+  for (;;) {
+    BatchJob *job;
+    {
+      unique_lock<mutex> lock(batchLock);
+      while (batchTodo.empty() && !batchEof) batchReady.wait(lock);
+      if (batchTodo.empty()) return;
+      job = batchTodo.front(); batchTodo.pop();
+    }
 
-  data = new Cplx*[rows];
-  For (i, rows) data[i] = new Cplx[cols];
+    job->m->out = open_memstream(&job->buf, &job->len);
+    job->m->solve();
+    fclose(job->m->out);
 
-  For (i, rows) {
-    For (j, cols) {
-      data[i][j] = Cplx(0, 0);
+    {
+      lock_guard<mutex> lock(batchLock);
+      job->done = true;
+    }
+    batchDone.notify_one();
+  }
+}
 
-      cin >> buf;
-      a = 0; b = 0;
-      s = 0;
+int batchMain(Input &in) {
+  int i, jobs = optJobs > 0 ? optJobs : max(1, (int)thread::hardware_concurrency());
+  int count = 0, status = 0;
+  string error;
+  deque<BatchJob *> pending;
+  vector<thread> workers;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  For (i, jobs) workers.push_back(thread(batchWorker));
+
+  for (;;) {
+    Matrix<Cplx> *m = readMatrix(in, error);
+    unique_lock<mutex> lock(batchLock);
+    if (m) {
+      BatchJob *job = new BatchJob();
+      job->m = m;
+      pending.push_back(job);
+      batchTodo.push(job);
+      batchReady.notify_one();
+    } else {
+      batchEof = true;
+      batchReady.notify_all();
+    }
 
-      while (buf[s]) {
-	ForL (r, s+1, strlen(buf)) {
-	  if (buf[r] == '+' || buf[r] == '-' || buf[r] == 'i' || !buf[r]) {
-	    break;
-	  }
-	}
+    while (!pending.empty() && (pending.front()->done || !m || (int)pending.size() > 4 * jobs)) {
+      while (!pending.front()->done) batchDone.wait(lock);
+      BatchJob *job = pending.front(); pending.pop_front();
+      lock.unlock();
 
-	if (buf[r] == 'i') ++r;
+      printf("========   MATRIX #%d   ========\n", ++count);
+      fwrite(job->buf, 1, job->len, stdout);
+      status = max(status, job->m->status);
+      free(job->buf);
+      delete job->m;
+      delete job;
 
-	Clear(tok);
-	strncpy(tok, buf+s, (r-s));
-	v = sscanf(tok, "%Ld/%Ld", &a, &b);
+      lock.lock();
+    }
+    if (!m) break;
+  }
 
-	if (tok[strlen(tok)-1] == 'i' && v == 0) {
-	  a = b = 1;
-	  if (tok[0] == '-') a = -1;
-	} else {
-	  switch (v) {
-	  case 2: break;
-	  case 1: b = 1; break;
-	  default: printf("Invalid input data, buf=\"%s\" tok=\"%s\".\n", buf, tok); exit(1);
-	  }
-	}
+  For (i, jobs) workers[i].join();
+  if (!error.empty()) {
+    printf("%s\n", error.c_str());
+    status = max(status, 1);
+  }
 
-	if (tok[r-s-1] == 'i') {
-	  data[i][j].imag = Frac(a, b);
-	} else {
-	  data[i][j].real = Frac(a, b);
-	}
+  double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  fflush(stdout);
+  fprintf(stderr, "Batch: %d matrices in %.3f s (%.1f matrices/s, %d workers)\n",
+	  count, elapsed, elapsed > 0 ? count / elapsed : 0.0, jobs);
+  return status;
+}
+
+void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-s|--sparse] [-f|--float [-c|--check]] [-m|--det|--inverse|--rank|--nullspace|--solve]\n"
+	  "       [--pivot=norm|height|sparse] [--width=64|128|big] [-b|--batch [-j N]] [--stats[=json]] < matrix\n", prog);
+  fprintf(stderr, "  -s, --sparse   sparse elimination with Markowitz pivoting, prints only the RREF\n");
+  fprintf(stderr, "  -f, --float    complex<double> elimination, prints the numeric RREF and rank\n");
+  fprintf(stderr, "  -c, --check    verify rank and pivot columns of -f against an exact modular run\n");
+  fprintf(stderr, "  -m, --mod      rank and pivot columns over GF(998244353), blocked engine\n");
+  fprintf(stderr, "  --det          determinant\n");
+  fprintf(stderr, "  --inverse      inverse matrix\n");
+  fprintf(stderr, "  --rank         rank and pivot columns\n");
+  fprintf(stderr, "  --nullspace    basis of the nullspace\n");
+  fprintf(stderr, "  --solve        solve A X = B, B follows A in the input as a second matrix\n");
+  fprintf(stderr, "  --pivot=S      exact pivot choice: norm (smallest entry, default), height (shortest\n"
+	  "                 numerator/denominator) or sparse (sparsest row); reports the peak coefficient size;\n"
+	  "                 not with -s, -f or -m, which have pivot rules of their own\n");
+  fprintf(stderr, "  --width=W      integer width of the exact arithmetic: 64 (default), 128 or big;\n"
+	  "                 entries are still read as 64-bit fractions, and a reduction that\n"
+	  "                 overflows is redone at the next width\n");
+  fprintf(stderr, "  --stats[=json] counters and phase timers on stderr (needs -DGAUSS_STATS)\n");
+  fprintf(stderr, "  -b, --batch    solve every matrix of the input, in order, on a worker pool\n");
+  fprintf(stderr, "  -j, --jobs N   number of batch workers (default: one per CPU)\n");
+}
 
-	s = r;
+void parseArgs(int argc, char **argv) {
+  int i;
+  ForL (i, 1, argc) {
+    if (!strcmp(argv[i], "-s") || !strcmp(argv[i], "--sparse")) {
+      optSparse = true;
+    } else if (!strcmp(argv[i], "-f") || !strcmp(argv[i], "--float")) {
+      optFloat = true;
+    } else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--check")) {
+      optCheck = true;
+    } else if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--mod")) {
+      optMode = MODE_MOD;
+    } else if (!strcmp(argv[i], "--det")) {
+      optMode = MODE_DET;
+    } else if (!strcmp(argv[i], "--inverse")) {
+      optMode = MODE_INVERSE;
+    } else if (!strcmp(argv[i], "--rank")) {
+      optMode = MODE_RANK;
+    } else if (!strcmp(argv[i], "--nullspace")) {
+      optMode = MODE_NULLSPACE;
+    } else if (!strcmp(argv[i], "--solve")) {
+      optMode = MODE_SOLVE;
+    } else if (!strcmp(argv[i], "--stats") || !strcmp(argv[i], "--stats=json")) {
+      optStats = argv[i][7] ? 2 : 1;
+#ifndef GAUSS_STATS
+      fprintf(stderr, "%s: built without -DGAUSS_STATS, --stats is ignored.\n", argv[0]);
+#endif
+    } else if (!strncmp(argv[i], "--pivot=", 8)) {
+      For (optPivot, 3) if (!strcmp(argv[i] + 8, pivotNames[optPivot])) break;
+      if (optPivot == 3) {
+	usage(argv[0]);
+	exit(1);
       }
+      optPeak = true;
+    } else if (!strncmp(argv[i], "--width=", 8)) {
+      For (optWidth, 3) if (!strcmp(argv[i] + 8, widthNames[optWidth])) break;
+      if (optWidth == 3) {
+	usage(argv[0]);
+	exit(1);
+      }
+    } else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--batch")) {
+      optBatch = true;
+    } else if ((!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) && i+1 < argc) {
+      optJobs = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+      exit(1);
     }
   }
 
-  rrefStep();
+  // -s pivots by Markowitz cost, -f by magnitude and -m takes the first
+  // nonzero entry, so none of them would honour --pivot.
+  if (optPeak && (optMode == MODE_MOD || (optMode == MODE_RREF && (optSparse || optFloat)))) {
+    fprintf(stderr, "%s: --pivot applies to the exact dense elimination only, not to -s, -f or -m.\n", argv[0]);
+    exit(1);
+  }
+}
+
+// Summary of the GAUSS_STATS counters on stderr, as text (--stats) or JSON
+// (--stats=json). Times of batch workers add up across threads.
+void printStats() {
+#ifdef GAUSS_STATS
+  if (!optStats) return;
+  {
+    lock_guard<mutex> lock(statsLock);
+    statsTotal.merge(statsLocal);
+  }
+  statsLocal.clear();
+
+  const Stats &s = statsTotal;
+  double eliminate = s.solveTime - s.printTime;
+  fflush(stdout);
+  if (optStats == 2) {
+    fprintf(stderr, "{\"parse_ms\": %.3f, \"eliminate_ms\": %.3f, \"print_ms\": %.3f, "
+	    "\"gcd_calls\": %llu, \"lcm_calls\": %llu, \"frac_ops\": %llu, \"overflows\": %llu, "
+	    "\"pivots\": %llu, \"rows_touched\": %llu, \"gemm_muls\": %llu, \"gemm_ms\": %.3f}\n",
+	    s.parseTime * 1e3, eliminate * 1e3, s.printTime * 1e3,
+	    s.gcdCalls, s.lcmCalls, s.fracOps, s.overflows, s.pivots, s.rowsTouched,
+	    s.gemmMuls, s.gemmTime * 1e3);
+  } else {
+    fprintf(stderr, "******   STATISTICS   ******\n");
+    fprintf(stderr, "parse          %12.3f ms\n", s.parseTime * 1e3);
+    fprintf(stderr, "eliminate      %12.3f ms\n", eliminate * 1e3);
+    fprintf(stderr, "print          %12.3f ms\n", s.printTime * 1e3);
+    fprintf(stderr, "gcd calls      %12llu\n", s.gcdCalls);
+    fprintf(stderr, "lcm calls      %12llu\n", s.lcmCalls);
+    fprintf(stderr, "Frac ops       %12llu\n", s.fracOps);
+    fprintf(stderr, "ll overflows   %12llu\n", s.overflows);
+    fprintf(stderr, "pivots         %12llu\n", s.pivots);
+    fprintf(stderr, "rows / pivot   %12.2f\n", s.pivots ? (double)s.rowsTouched / s.pivots : 0.0);
+    if (s.gemmMuls) {
+      fprintf(stderr, "gemm           %12.3f ms\n", s.gemmTime * 1e3);
+      fprintf(stderr, "gemm rate      %12.3f Gmul/s\n", s.gemmMuls / s.gemmTime * 1e-9);
+    }
+  }
+#endif
+}
+
+void _main() {
+  int status;
+  Input in(0);
+
+  if (optBatch) {
+    status = batchMain(in);
+  } else {
+    string error;
+    Matrix<Cplx> *m = readMatrix(in, error);
+    if (!m) {
+      printf("%s\n", error.empty() ? "Invalid input data, expected \"rows cols\"." : error.c_str());
+      exit(1);
+    }
+    m->solve();
+    status = m->status;
+    delete m;
+  }
 
-  For (i, rows) delete [] data[i];
-  delete [] data;
+  printStats();
+  if (status) exit(status);
 }
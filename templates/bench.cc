@@ -0,0 +1,256 @@
+// Benchmarks for the templates: g++ -O2 -pthread bench.cc -o bench
+//   ./bench fenwick [n] [adds per thread] [max threads]
+//   ./bench random [n]
+//   ./bench bigint [operands]   (operands from ./gen bigint, default stdin)
+//   ./bench io [n]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bigint.h"
+#include "fenwick.h"
+#include "fastio.h"
+#include "random.cc"
+
+using namespace std;
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Runs body(thread index) on the given number of threads and returns the
+// wall time.
+template <typename Body>
+double run_threads(int threads, Body body) {
+  vector<thread> pool;
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) pool.push_back(thread(body, t));
+  for (auto &t : pool) t.join();
+  return seconds_since(start);
+}
+
+// Every thread adds to random indices of one shared tree, with a get
+// every 64 adds; prints millions of operations per second.
+template <typename Add, typename Get>
+double fenwick_rate(int n, int ops, int threads, Add add, Get get) {
+  double elapsed = run_threads(threads, [&](int t) {
+    uint64_t x = 88172645463325252ULL ^ (t + 1) * 0x9E3779B97F4A7C15ULL;
+    long long seen = 0;
+    for (int i = 0; i < ops; ++i) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      int index = x % n;
+      if (i % 64 == 63) {
+        seen += get(0, index);
+      } else {
+        add(index, 1);
+      }
+    }
+    if (seen < 0) printf("!");
+  });
+  return (double)ops * threads / elapsed / 1e6;
+}
+
+void bench_fenwick(int n, int ops, int max_threads) {
+  printf("Fenwick, n = %d, %d ops per thread, 1/64 gets (Mops/s)\n", n, ops);
+  printf("%8s %12s %12s %12s\n", "threads", "mutex", "atomic", "sharded");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    Fenwick<long long> plain(n);
+    mutex lock;
+    double locked = fenwick_rate(n, ops, threads,
+        [&](int i, long long d) { lock_guard<mutex> hold(lock); plain.add(i, d); },
+        [&](int l, int r) { lock_guard<mutex> hold(lock); return plain.get(l, r); });
+
+    ConcurrentFenwick<long long> atomic_tree(n);
+    double atomic = fenwick_rate(n, ops, threads,
+        [&](int i, long long d) { atomic_tree.add(i, d); },
+        [&](int l, int r) { return atomic_tree.get(l, r); });
+
+    // One shard per thread, so that each thread keeps its own.
+    ShardedFenwick<long long> sharded(n, threads);
+    double shards = fenwick_rate(n, ops, threads,
+        [&](int i, long long d) { sharded.add(i, d); },
+        [&](int l, int r) { return sharded.get(l, r); });
+
+    printf("%8d %12.2f %12.2f %12.2f\n", threads, locked, atomic, shards);
+  }
+}
+
+// Nanoseconds per call of body(i) over n calls; the results are summed
+// into sink so that nothing is optimized away.
+template <typename Body>
+double ns_per_call(int n, double &sink, Body body) {
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i) sink += body(i);
+  return seconds_since(start) / n * 1e9;
+}
+
+void bench_random(int n) {
+  printf("RandomGenerator against <random>, %d calls each (ns per value)\n", n);
+  // A bound only known at run time, as in real use; a constant one would
+  // let the compiler turn the modulo into a multiplication.
+  const uint32_t bound = 1000003 + (n & 1);
+  double sink = 0;
+  RandomGenerator g(1);
+  mt19937_64 mt(1);
+
+  printf("%-28s %8.2f\n", "next(bound) (modulo)", ns_per_call(n, sink, [&](int) { return g.next(bound); }));
+  printf("%-28s %8.2f\n", "bounded(bound)", ns_per_call(n, sink, [&](int) { return g.bounded(bound); }));
+  uniform_int_distribution<uint32_t> ints(0, bound - 1);
+  printf("%-28s %8.2f\n", "uniform_int_distribution", ns_per_call(n, sink, [&](int) { return ints(mt); }));
+
+  printf("%-28s %8.2f\n", "uniform()", ns_per_call(n, sink, [&](int) { return g.uniform(); }));
+  uniform_real_distribution<double> reals;
+  printf("%-28s %8.2f\n", "uniform_real_distribution", ns_per_call(n, sink, [&](int) { return reals(mt); }));
+
+  printf("%-28s %8.2f\n", "normal()", ns_per_call(n, sink, [&](int) { return g.normal(); }));
+  normal_distribution<double> normals;
+  printf("%-28s %8.2f\n", "normal_distribution", ns_per_call(n, sink, [&](int) { return normals(mt); }));
+
+  vector<uint32_t> values(n);
+  iota(values.begin(), values.end(), 0);
+  printf("%-28s %8.2f\n", "shuffle()", ns_per_call(1, sink, [&](int) { g.shuffle(values.begin(), values.end()); return values[0]; }) / n);
+  printf("%-28s %8.2f\n", "std::shuffle", ns_per_call(1, sink, [&](int) { std::shuffle(values.begin(), values.end(), mt); return values[0]; }) / n);
+
+  printf("%-28s %8.2f\n", "fill()", ns_per_call(1, sink, [&](int) { g.fill(values.data(), n); return values[0]; }) / n);
+  if (sink == 42) printf("!");
+}
+
+// Consecutive numbers of the input are taken as operand pairs (a, b);
+// prints microseconds per operation over all pairs.
+void bench_bigint(istream &in) {
+  vector<string> text;
+  string s;
+  while (in >> s) text.push_back(s);
+  vector<BigInt> a, b;
+  size_t digits = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i + 1 < text.size(); i += 2) {
+    a.push_back(BigInt(text[i]));
+    b.push_back(BigInt(text[i + 1]));
+    digits += text[i].size() + text[i + 1].size();
+  }
+  int pairs = a.size();
+  if (!pairs) {
+    fprintf(stderr, "bench bigint: expected at least two numbers\n");
+    return;
+  }
+  double parse = seconds_since(start) / (2 * pairs) * 1e6;
+  printf("BigInt, %d operand pairs, %.0f digits on average (us per operation)\n",
+         pairs, (double)digits / (2 * pairs));
+  printf("%-12s %12.2f\n", "parse", parse);
+
+  long long sink = 0;
+  auto time_op = [&](const char *name, function<BigInt(int)> op) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < pairs; ++i) sink += op(i).log2();
+    printf("%-12s %12.2f\n", name, seconds_since(start) / pairs * 1e6);
+  };
+  time_op("a + b", [&](int i) { return a[i] + b[i]; });
+  time_op("a - b", [&](int i) { return a[i] - b[i]; });
+  time_op("a * b", [&](int i) { return a[i] * b[i]; });
+  time_op("a * b / b", [&](int i) { return a[i] * b[i] / b[i]; });
+  time_op("a % b", [&](int i) { return a[i] % b[i]; });
+  time_op("str(a)", [&](int i) { BigInt t(a[i]); sink += t.str().size(); return t; });
+  if (sink == 42) printf("!");
+}
+
+// n signed 64-bit integers, 10 per line, through a temporary file;
+// prints nanoseconds per number.
+void bench_io(int n) {
+  printf("Reading and writing %d integers (ns per number)\n", n);
+  const string path = "/tmp/bench_io_" + to_string(getpid()) + ".txt";
+  vector<long long> values(n);
+  RandomGenerator g(1);
+  for (int i = 0; i < n; ++i) values[i] = (long long)g.next64() >> g.bounded(64);
+
+  auto time_write = [&](const char *name, function<void(FILE *)> body) {
+    FILE *f = fopen(path.c_str(), "w");
+    auto start = chrono::steady_clock::now();
+    body(f);
+    fclose(f);
+    printf("%-28s %8.2f\n", name, seconds_since(start) / n * 1e9);
+  };
+  long long sum = 0;
+  auto time_read = [&](const char *name, function<long long(FILE *)> body) {
+    FILE *f = fopen(path.c_str(), "r");
+    auto start = chrono::steady_clock::now();
+    long long s = body(f);
+    printf("%-28s %8.2f%s\n", name, seconds_since(start) / n * 1e9, s == sum ? "" : "  (wrong sum)");
+    fclose(f);
+  };
+
+  time_write("printf", [&](FILE *f) {
+    for (int i = 0; i < n; ++i) fprintf(f, i % 10 == 9 ? "%lld\n" : "%lld ", values[i]);
+  });
+  time_write("ostream", [&](FILE *) {
+    ofstream os(path);
+    for (int i = 0; i < n; ++i) os << values[i] << (i % 10 == 9 ? '\n' : ' ');
+  });
+  time_write("FastOutput", [&](FILE *f) {
+    FastOutput w(f);
+    for (int i = 0; i < n; ++i) w.write(values[i], i % 10 == 9 ? '\n' : ' ');
+  });
+  for (long long v : values) sum += v;
+
+  time_read("scanf", [&](FILE *f) {
+    long long s = 0, v;
+    while (fscanf(f, "%lld", &v) == 1) s += v;
+    return s;
+  });
+  time_read("istream", [&](FILE *) {
+    ifstream is(path);
+    long long s = 0, v;
+    while (is >> v) s += v;
+    return s;
+  });
+  time_read("FastInput", [&](FILE *f) {
+    FastInput r(f);
+    long long s = 0, v;
+    while (r.read(v)) s += v;
+    return s;
+  });
+  unlink(path.c_str());
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "fenwick")) {
+    bench_fenwick(argc > 2 ? atoi(argv[2]) : 1 << 20,
+                  argc > 3 ? atoi(argv[3]) : 1 << 20,
+                  argc > 4 ? atoi(argv[4]) : 64);
+  } else if (argc >= 2 && !strcmp(argv[1], "random")) {
+    bench_random(argc > 2 ? atoi(argv[2]) : 10000000);
+  } else if (argc >= 2 && !strcmp(argv[1], "bigint")) {
+    if (argc > 2) {
+      ifstream in(argv[2]);
+      if (!in) {
+        perror(argv[2]);
+        return 1;
+      }
+      bench_bigint(in);
+    } else {
+      bench_bigint(cin);
+    }
+  } else if (argc >= 2 && !strcmp(argv[1], "io")) {
+    bench_io(argc > 2 ? atoi(argv[2]) : 10000000);
+  } else {
+    fprintf(stderr, "Usage: %s fenwick [n] [adds per thread] [max threads]\n"
+                    "       %s random [n]\n"
+                    "       %s bigint [operands]\n"
+                    "       %s io [n]\n", argv[0], argv[0], argv[0], argv[0]);
+    return 1;
+  }
+  return 0;
+}
@@ -455,7 +455,7 @@ private:
 
     while (b) {
       t = b | r;
-      c = 1 << t;
+      c = (uint_fast32_t) 1 << t;
       if (c <= n) r = t;
       b >>= 1;
     }
@@ -0,0 +1,102 @@
+// Exact complex numbers over a field F, e.g. Complex<Rational<int64_t>>.
+// F needs + - * /, == and <, isZero(), val() and str(), plus bits() if
+// Complex::bits() is used.
+
+#ifndef __CPLX_H__
+#define __CPLX_H__
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+template <typename F>
+class Complex {
+public:
+  typedef F value_type;
+
+  F real, imag;
+
+  Complex(const F &r = F(0), const F &i = F(0)) : real(r), imag(i) {}
+
+  template <typename G>
+  explicit Complex(const Complex<G> &v) : real(v.real), imag(v.imag) {}
+
+  const Complex conj() const { return Complex(real, -imag); }
+  const Complex inverse() const { F t = normSqr(); return Complex(real / t, -imag / t); }
+  const F normSqr() const { return real * real + imag * imag; }
+  bool isZero() const { return real.isZero() && imag.isZero(); }
+  long double norm() const { long double a = real.val(), b = imag.val(); return a*a+b*b; }
+  int bits() const { return max(real.bits(), imag.bits()); }
+
+  const Complex & operator+=(const Complex &rhs) {
+    real += rhs.real; imag += rhs.imag;
+    return *this;
+  }
+
+  const Complex & operator-=(const Complex &rhs) {
+    real -= rhs.real; imag -= rhs.imag;
+    return *this;
+  }
+
+  const Complex & operator*=(const Complex &rhs) {
+    *this = Complex(real * rhs.real - imag * rhs.imag, real * rhs.imag + imag * rhs.real);
+    return *this;
+  }
+
+  const Complex & operator/=(const Complex &rhs) {
+    Complex c = rhs.conj(); F t = rhs.normSqr();
+    *this *= c;
+    real /= t;
+    imag /= t;
+    return *this;
+  }
+
+  const Complex operator+(const Complex &rhs) const { Complex r(*this); r += rhs; return r; }
+  const Complex operator-(const Complex &rhs) const { Complex r(*this); r -= rhs; return r; }
+  const Complex operator*(const Complex &rhs) const { Complex r(*this); r *= rhs; return r; }
+  const Complex operator/(const Complex &rhs) const { Complex r(*this); r /= rhs; return r; }
+
+  bool operator==(const Complex &rhs) const { return real == rhs.real && imag == rhs.imag; }
+  bool operator!=(const Complex &rhs) const { return !(*this == rhs); }
+
+  // Like 3-(1/2)i: a fractional imaginary part is parenthesized, and a
+  // coefficient of 1 or -1 is left out. Works on the digits of imag, so
+  // printing builds no F temporaries.
+  const string str() const {
+    if (isZero()) return "0";
+    string result = "";
+
+    if (!real.isZero()) {
+      result += real.str();
+    }
+
+    if (!imag.isZero()) {
+      string s = imag.str();
+      bool neg = s[0] == '-';
+      if (!neg && result.size()) result += '+';
+      if (s == "-1") {
+	result += '-';
+      } else if (s != "1") {
+	if (s.find('/') == string::npos) {
+	  result += s;
+	} else if (!neg) {
+	  result += "(" + s + ")";
+	} else {
+	  result += "-(" + s.substr(1) + ")";
+	}
+      }
+      result += 'i';
+    }
+
+    return result;
+  }
+
+  char * c_str() const {
+    return strdup(str().c_str());
+  }
+};
+
+#endif // __CPLX_H__
@@ -0,0 +1,270 @@
+// Buffered input and output for contest programs, much faster than
+// iostreams or scanf/printf on large inputs.
+//
+//   int n; long long x; string s;
+//   fast_in.read(n, x, s);
+//   fast_out.write(n, ' ', x, '\n');
+//
+// fast_in and fast_out work on stdin and stdout, whatever those are when
+// the first read or write happens, so freopen() in main() still applies. Do
+// not mix them with other I/O on the same stream without fast_out.flush()
+// in between. The names keep clear of the fin and fout that USACO code
+// declares as fstreams.
+// Include bigint.h first to read and write BigInt.
+
+#ifndef __FASTIO_H__
+#define __FASTIO_H__
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Whitespace separated tokens. A regular file is mmap'ed whole, anything
+// else is read in large blocks. Numbers and strings are parsed straight
+// from the buffer, and whitespace is any character up to ' '.
+class FastInput {
+public:
+  FastInput(FILE *file = stdin) : file(file), buf(NULL), p(NULL), end(NULL), cap(0), mapped(false), eof(false) {}
+
+  ~FastInput() {
+    if (mapped) munmap(buf, cap); else free(buf);
+  }
+
+  // Signed or unsigned integers of any width, with an optional sign.
+  // Returns false at end of input or if the token does not start with a
+  // number; overflow wraps around.
+  template <typename T>
+  typename enable_if<is_integral<T>::value && !is_same<T, bool>::value, bool>::type read(T &v) {
+    if (!skip()) return false;
+    bool neg = *p == '-';
+    if (neg || *p == '+') ++p;
+    if (p == end || !is_digit(*p)) return false;
+    typename make_unsigned<T>::type x = *p++ - '0';
+    for (;;) {
+      while (p < end && is_digit(*p)) x = x * 10 + (*p++ - '0');
+      if (p < end || eof) break;
+      refill();
+    }
+    v = neg ? -x : x;
+    return true;
+  }
+
+  // A number, true unless it is 0.
+  bool read(bool &b) {
+    long long v;
+    if (!read(v)) return false;
+    b = v != 0;
+    return true;
+  }
+
+  // The next non-whitespace character.
+  bool read(char &c) {
+    if (!skip()) return false;
+    c = *p++;
+    return true;
+  }
+
+  bool read(string &s) {
+    char *e = token();
+    if (!e) return false;
+    s.assign(p, e);
+    p = e;
+    return true;
+  }
+
+#ifdef __BIGINT_H__
+  bool read(BigInt &v) {
+    char *e = token();
+    if (!e) return false;
+    v = BigInt(string(p, e));
+    p = e;
+    return true;
+  }
+#endif
+
+  template <typename T, typename U, typename... Rest>
+  bool read(T &first, U &second, Rest &...rest) {
+    return read(first) && read(second, rest...);
+  }
+
+private:
+  // skip() keeps at least this many bytes in the buffer, so that a
+  // number rarely runs into its end and needs a refill halfway.
+  static const int LOOKAHEAD = 64;
+
+  FILE *file;
+  char *buf, *p, *end;
+  size_t cap;
+  bool mapped, eof;
+
+  static bool is_space(char c) { return (unsigned char)c <= ' '; }
+  static bool is_digit(char c) { return (unsigned)(c - '0') < 10; }
+
+  // Moves past whitespace; false at end of input.
+  bool skip() {
+    for (;;) {
+      while (p < end && is_space(*p)) ++p;
+      if (end - p >= LOOKAHEAD || eof) return p < end;
+      refill();
+    }
+  }
+
+  // The end of the next token, which is then entirely in [p, end).
+  // Returns NULL at end of input.
+  char *token() {
+    if (!skip()) return NULL;
+    for (;;) {
+      char *q = p;
+      while (q < end && !is_space(*q)) ++q;
+      if (q < end || eof) return q;
+      refill();
+    }
+  }
+
+  void open() {
+    struct stat st;
+    int fd = fileno(file);
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+      off_t at = lseek(fd, 0, SEEK_CUR);
+      void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (at >= 0 && m != MAP_FAILED) {
+        madvise(m, st.st_size, MADV_SEQUENTIAL);
+        buf = (char *)m; cap = st.st_size;
+        p = buf + at; end = buf + cap;
+        mapped = eof = true;
+        return;
+      }
+      if (m != MAP_FAILED) munmap(m, st.st_size);
+    }
+    cap = 1 << 16;
+    buf = (char *)malloc(cap);
+    p = end = buf;
+  }
+
+  // Keeps the unread bytes and appends more, growing the buffer when a
+  // single token fills it.
+  void refill() {
+    if (!buf) {
+      open();
+      if (mapped) return;
+    }
+    size_t keep = end - p;
+    if (p != buf) memmove(buf, p, keep);
+    if (keep == cap) buf = (char *)realloc(buf, cap *= 2);
+    p = buf; end = buf + keep;
+
+    ssize_t n;
+    do {
+      n = ::read(fileno(file), end, cap - keep);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) eof = true; else end += n;
+  }
+};
+
+// Output is collected in a buffer and handed to the FILE in large
+// blocks; integers are formatted two digits at a time.
+class FastOutput {
+public:
+  FastOutput(FILE *file = stdout) : file(file), p(buf) {}
+  ~FastOutput() {
+    if (p != buf) flush();
+  }
+
+  void flush() {
+    fwrite(buf, 1, p - buf, file);
+    fflush(file);
+    p = buf;
+  }
+
+  template <typename T>
+  typename enable_if<is_integral<T>::value && !is_same<T, bool>::value>::type write(T v) {
+    reserve(48);
+    typename make_unsigned<T>::type u = v;
+    if (v < 0) {
+      *p++ = '-';
+      u = -u;
+    }
+    char digits[40], *d = digits + sizeof(digits);
+    while (u >= 100) {
+      d -= 2;
+      memcpy(d, pairs() + u % 100 * 2, 2);
+      u /= 100;
+    }
+    if (u >= 10) {
+      d -= 2;
+      memcpy(d, pairs() + u * 2, 2);
+    } else {
+      *--d = '0' + u;
+    }
+    size_t n = digits + sizeof(digits) - d;
+    memcpy(p, d, n);
+    p += n;
+  }
+
+  void write(char c) {
+    reserve(1);
+    *p++ = c;
+  }
+
+  // 1 or 0, like printf("%d").
+  void write(bool b) { write(b ? '1' : '0'); }
+
+  void write(const char *s) { put(s, strlen(s)); }
+  void write(const string &s) { put(s.data(), s.size()); }
+
+#ifdef __BIGINT_H__
+  void write(BigInt v) { write(v.str()); }
+#endif
+
+  template <typename T, typename U, typename... Rest>
+  void write(const T &first, const U &second, const Rest &...rest) {
+    write(first);
+    write(second, rest...);
+  }
+
+private:
+  static const size_t SIZE = 1 << 16;
+
+  FILE *file;
+  char buf[SIZE], *p;
+
+  void reserve(size_t n) {
+    if (buf + SIZE - p < (ptrdiff_t)n) flush();
+  }
+
+  void put(const char *s, size_t n) {
+    if (n >= SIZE) {
+      flush();
+      fwrite(s, 1, n, file);
+      return;
+    }
+    reserve(n);
+    memcpy(p, s, n);
+    p += n;
+  }
+
+  static const char *pairs() {
+    return
+      "0001020304050607080910111213141516171819"
+      "2021222324252627282930313233343536373839"
+      "4041424344454647484950515253545556575859"
+      "6061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+  }
+};
+
+// Programs are a single translation unit, so these are defined here;
+// static keeps a second unit that includes this header linking, with
+// buffers of its own.
+static FastInput fast_in;
+static FastOutput fast_out;
+
+#endif // __FASTIO_H__
@@ -2,21 +2,168 @@
 #define __FENWICK_H__
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-// Zero-indexed Fenwick Tree
-template <typename T = long long>
+// Node storage for Fenwick: owns the N nodes and maps a node index to
+// its slot. HeapStorage is a plain array.
+template <typename T, typename I = int>
+class HeapStorage {
+public:
+  HeapStorage(I n) : data(new T[n]), N(n) {}
+  ~HeapStorage() { delete [] data; }
+
+  void init(const T &zero) { std::fill_n(data, N, zero); }
+  void sync() {}
+
+  T& operator[](I i) { return data[i]; }
+  const T& operator[](I i) const { return data[i]; }
+
+private:
+  T* data;
+  I N;
+};
+
+// Nodes in a memory-mapped file, for trees larger than RAM. The file
+// keeps a small header, so reopening it with the same N and T takes the
+// tree as it was, without reading or rebuilding anything.
+//
+// Nodes are laid out by level instead of by index: node i != 0 with
+// lowest bit 2^k goes to slot j = i >> (k + 1) of level k, and levels are
+// stored from the top down after node 0. Every walk passes through the
+// few upper levels, which now share a handful of pages at the front of
+// the file that stay resident, while the large lower levels are paged
+// in on demand.
+template <typename T, typename I = int>
+class MappedStorage {
+  static_assert(std::is_trivially_copyable<T>::value, "MappedStorage needs a trivially copyable T");
+public:
+  MappedStorage(I n, const std::string &path) : N(n) {
+    level[0] = 1;
+    int top = 0;
+    while (top + 1 < 64 && (((uint64_t)N - 1) >> (top + 1)) > 0) ++top;
+    // Levels top..0 follow node 0, largest lowest bit first.
+    uint64_t at = 1;
+    for (int k = 63; k >= 0; --k) {
+      level[k] = at;
+      if (k <= top && N > 1) at += ((((uint64_t)N - 1) >> k) + 1) >> 1;
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) fail("open", path);
+    struct stat st;
+    if (fstat(fd, &st)) fail("fstat", path);
+    Header expected = {{'F', 'E', 'N', 'W', 'I', 'C', 'K', '1'}, sizeof(T), (uint64_t)N};
+    bytes = sizeof(Header) + (uint64_t)N * sizeof(T);
+    if (st.st_size) {
+      Header found;
+      if (pread(fd, &found, sizeof(found), 0) != (ssize_t)sizeof(found) ||
+          memcmp(&found, &expected, sizeof(found)) || (uint64_t)st.st_size != bytes) {
+        close(fd);
+        throw std::runtime_error(path + ": not a Fenwick tree of this size and type");
+      }
+      fresh = false;
+    } else {
+      if (ftruncate(fd, bytes) || pwrite(fd, &expected, sizeof(expected), 0) != (ssize_t)sizeof(expected)) {
+        fail("create", path);
+      }
+      fresh = true;
+    }
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) fail("mmap", path);
+    data = (T*)((char*)base + sizeof(Header));
+
+    // The lower levels are hit at random; the top ones (levels 8 and up,
+    // under 1/256 of the nodes) are wanted right away.
+    madvise(base, bytes, MADV_RANDOM);
+    uint64_t hot = (sizeof(Header) + level[std::min(top, 7)] * sizeof(T)) & ~(uint64_t)4095;
+    if (hot) madvise(base, hot, MADV_WILLNEED);
+  }
+
+  ~MappedStorage() {
+    munmap(base, bytes);
+    close(fd);
+  }
+
+  // A new file is zero-filled by the filesystem, so only a zero that is
+  // not all zero bytes needs writing; a reopened tree is left alone.
+  void init(const T &zero) {
+    if (!fresh) return;
+    static const char none[sizeof(T)] = {};
+    if (memcmp(&zero, none, sizeof(T))) std::fill_n(data, N, zero);
+    fresh = false;
+  }
+
+  void sync() { msync(base, bytes, MS_SYNC); }
+
+  T& operator[](I i) { return data[slot(i)]; }
+  const T& operator[](I i) const { return data[slot(i)]; }
+
+private:
+  struct Header {
+    char magic[8];
+    uint64_t size, count;
+  };
+
+  I N;
+  int fd;
+  bool fresh;
+  uint64_t bytes;
+  uint64_t level[64];
+  void* base;
+  T* data;
+
+  uint64_t slot(I i) const {
+    if (!i) return 0;
+    int k = __builtin_ctzll((uint64_t)i);
+    return level[k] + ((uint64_t)i >> (k + 1));
+  }
+
+  void fail(const char* what, const std::string &path) {
+    std::string message = path + ": " + what + ": " + strerror(errno);
+    if (fd >= 0) close(fd);
+    throw std::runtime_error(message);
+  }
+};
+
+// Zero-indexed Fenwick Tree. I is the index type; use int64_t for more
+// than 2^31 elements. Storage holds the nodes: HeapStorage by default, or
+// MappedStorage to keep them in a file, e.g.
+//   Fenwick<long long, int64_t, MappedStorage<long long, int64_t> > t(n, 0, "counts.fw");
+template <typename T = long long, typename I = int, typename Storage = HeapStorage<T, I> >
 class Fenwick {
 public:
-  Fenwick(int n, T zero = T(0LL)) {
-    N = n;
-    S = new T[N];
-    Z = zero;
-    std::fill_n(S, N, Z);
+  // Extra arguments go to the Storage constructor after n.
+  template <typename... Args>
+  Fenwick(I n, T zero = T(0LL), Args&&... args) : N(n), S(n, std::forward<Args>(args)...), Z(zero) {
+    S.init(Z);
   }
 
-  ~Fenwick() { delete [] S; }
+  // Builds the tree over [first, last) in O(N).
+  template <typename It, typename = decltype(*std::declval<It&>()), typename... Args>
+  Fenwick(It first, It last, T zero = T(0LL), Args&&... args)
+      : N(std::distance(first, last)), S(N, std::forward<Args>(args)...), Z(zero) {
+    for (I i = 0; i < N; ++i, ++first) S[i] = *first;
+    build(S);
+  }
 
-  void add(int index, T delta) {
+  void add(I index, T delta) {
     if (!index) {
       S[0] += delta;
       return;
@@ -27,24 +174,577 @@ public:
     }
   }
 
+  T get(I left, I right) const {
+    return sum(right) - sum(left - 1);
+  }
+
+  // Writes the nodes back to the file behind a MappedStorage.
+  void sync() { S.sync(); }
+
+  // The first index whose prefix sum get(0, index) reaches target, or N
+  // if none does; elements must be non-negative. One descent over the
+  // tree, for weighted sampling and order statistics (with 0/1 counts,
+  // lower_bound(k) is the k-th present index).
+  I lower_bound(T target) const {
+    if (!N || !(S[0] < target)) return 0;
+    target -= S[0];
+    // Nodes 1..N-1 form a plain one-indexed tree after node 0.
+    I p = 0;
+    for (I step = highest_bit(N - 1); step; step >>= 1) {
+      if (p + step < N && S[p + step] < target) {
+        p += step;
+        target -= S[p];
+      }
+    }
+    return p + 1;
+  }
+
+  // add(index[i], delta[i]) for all i. The updates are sorted by index,
+  // repeated indices folded together, and the paths walked front to
+  // back: nodes shared with the previous path are still in L1, and the
+  // next starting points are prefetched. A batch that would touch most
+  // of the tree is folded in with an O(N) build instead, see add_dense().
+  void add_many(const I* index, const T* delta, int count) {
+    if ((int64_t)count * 4 >= N) {
+      add_dense(index, delta, count);
+      return;
+    }
+    std::vector<Key> keys(count);
+    for (int i = 0; i < count; ++i) keys[i] = (Key)index[i] << 32 | i;
+    sort_keys(keys);
+    for (int k = 0; k < count; ) {
+      if (k + 8 < count) __builtin_prefetch(&S[(I)(keys[k + 8] >> 32)], 1);
+      I x = keys[k] >> 32;
+      T d = delta[(uint32_t)keys[k++]];
+      while (k < count && (I)(keys[k] >> 32) == x) d += delta[(uint32_t)keys[k++]];
+      add(x, d);
+    }
+  }
+
+  // out[i] = get(left[i], right[i]) for all i. The 2 * count prefix sums
+  // are taken in sorted order, each from the previous one by walking both
+  // paths only down to where they meet.
+  void get_many(const I* left, const I* right, T* out, int count) const {
+    // Prefix sums of [0, p) for p = left and right + 1, keyed by p.
+    std::vector<Key> keys(2 * count);
+    for (int i = 0; i < count; ++i) {
+      keys[2 * i] = (Key)left[i] << 32 | 2 * i;
+      keys[2 * i + 1] = (Key)(right[i] + 1) << 32 | (2 * i + 1);
+    }
+    sort_keys(keys);
+    std::vector<T> prefix(2 * count, Z);
+    I last = -1;
+    T running = Z;
+    for (int k = 0; k < 2 * count; ++k) {
+      if (k + 8 < 2 * count && keys[k + 8] >> 32) __builtin_prefetch(&S[(I)(keys[k + 8] >> 32) - 1]);
+      I p = (I)(keys[k] >> 32) - 1;
+      if (p > last) {
+        running += between(last, p);
+        last = p;
+      }
+      prefix[(uint32_t)keys[k]] = running;
+    }
+    for (int i = 0; i < count; ++i) {
+      out[i] = prefix[2 * i + 1] - prefix[2 * i];
+    }
+  }
+
+private:
+  // Sort keys for the batched calls: the index above a 32-bit slot.
+  typedef typename std::conditional<sizeof(I) <= 4, uint64_t, unsigned __int128>::type Key;
+
+  I N;
+  Storage S;
+  T Z;
+  static inline I lowest_bit(I n) { return n & (-n); }
+  static inline I highest_bit(I n) {
+    I bit = 1;
+    while (n >>= 1) bit <<= 1;
+    return bit;
+  }
+
+  // LSD radix sort on the index part of the keys, 8 bits a pass and only
+  // as many passes as indices up to N need.
+  void sort_keys(std::vector<Key> &keys) const {
+    std::vector<Key> buffer(keys.size());
+    for (int shift = 32; (Key)N >> (shift - 32); shift += 8) {
+      size_t count[257] = {0};
+      for (size_t i = 0; i < keys.size(); ++i) ++count[(keys[i] >> shift & 255) + 1];
+      for (int i = 0; i < 256; ++i) count[i + 1] += count[i];
+      for (size_t i = 0; i < keys.size(); ++i) buffer[count[keys[i] >> shift & 255]++] = keys[i];
+      keys.swap(buffer);
+    }
+  }
+
+  // The dense case of add_many(): the deltas are laid out and turned into
+  // tree nodes like build() does, but one bounded chunk of indices at a
+  // time instead of in an N-sized array, so a MappedStorage tree costs no
+  // extra memory. A total passed on beyond the chunk goes to an ancestor
+  // of the chunk's last node; those have distinct lowest bits, so one
+  // carry per bit holds them until their chunk comes.
+  void add_dense(const I* index, const T* delta, int count) {
+    const I B = 1 << 14;
+    const int BITS = 64;
+    I chunks = (N + B - 1) / B, lo, hi, i, j;
+    std::vector<int> start(chunks + 1, 0), order(count);
+    for (int k = 0; k < count; ++k) ++start[index[k] / B + 1];
+    for (I c = 0; c < chunks; ++c) start[c + 1] += start[c];
+    std::vector<int> next(start.begin(), start.end() - 1);
+    for (int k = 0; k < count; ++k) order[next[index[k] / B]++] = k;
+
+    std::vector<T> D(std::min(B, N), Z), carry(BITS, Z);
+    I target[BITS];
+    uint64_t waiting = 0;
+    for (I c = 0; c < chunks; ++c) {
+      lo = c * B; hi = std::min(N, lo + B);
+      std::fill(D.begin(), D.begin() + (hi - lo), Z);
+      for (int k = start[c]; k < start[c + 1]; ++k) D[index[order[k]] - lo] += delta[order[k]];
+      for (uint64_t w = waiting; w; w &= w - 1) {
+        int b = __builtin_ctzll(w);
+        if (target[b] < hi) {
+          D[target[b] - lo] += carry[b];
+          carry[b] = Z;
+          waiting &= ~(1ULL << b);
+        }
+      }
+      if (!lo) S[0] += D[0];
+      for (i = std::max(lo, (I)1); i < hi; ++i) {
+        const T &d = D[i - lo];
+        if (d == Z) continue;
+        S[i] += d;
+        j = i + lowest_bit(i);
+        if (j < hi) {
+          D[j - lo] += d;
+        } else if (j < N) {
+          int b = __builtin_ctzll((uint64_t)j);
+          if (waiting >> b & 1) {
+            carry[b] += d;
+          } else {
+            carry[b] = d;
+            target[b] = j;
+            waiting |= 1ULL << b;
+          }
+        }
+      }
+    }
+  }
+
+  // Turns the N values in A into tree nodes in place: every node passes
+  // its total on to the next node covering it.
+  template <typename Array>
+  void build(Array &A) const {
+    for (I i = 1; i < N; ++i) {
+      I j = i + lowest_bit(i);
+      if (j < N) A[j] += A[i];
+    }
+  }
+
+  // sum(b) - sum(a) for -1 <= a < b. Both paths end at node 0, and the
+  // larger index is never on the other's path, so it steps first.
+  T between(I a, I b) const {
+    if (a < 0) return sum(b);
+    T plus = Z, minus = Z;
+    while (a != b) {
+      if (b > a) {
+        plus += S[b];
+        b -= lowest_bit(b);
+      } else {
+        minus += S[a];
+        a -= lowest_bit(a);
+      }
+    }
+    return plus - minus;
+  }
+  T sum(I p) const {
+    if (p < 0) return Z;
+    T result = S[p];
+    I mask;
+    while ( (mask = lowest_bit(p)) ) {
+      result += S[p -= mask];
+    }
+    return result;
+  }
+};
+
+// Zero-indexed Fenwick Tree with range updates, on two Fenwick trees.
+// After adding delta to [l, r], the prefix sum up to p is
+// D(p) * (p + 1) - E(p) with D and E the prefix sums of the two trees.
+template <typename T = long long>
+class RangeFenwick {
+public:
+  RangeFenwick(int n, T zero = T(0LL)) : N(n), Z(zero), D(n, zero), E(n, zero) {}
+
+  void add(int left, int right, T delta) {
+    D.add(left, delta);
+    E.add(left, delta * T((long long)left));
+    if (right + 1 < N) {
+      D.add(right + 1, Z - delta);
+      E.add(right + 1, Z - delta * T((long long)right + 1));
+    }
+  }
+
+  void add(int index, T delta) { add(index, index, delta); }
+
   T get(int left, int right) const {
     return sum(right) - sum(left - 1);
   }
 
 private:
   int N;
-  T* S;
   T Z;
-  static inline int lowest_bit(register int n) { return n & (-n); }
+  Fenwick<T> D, E;
   T sum(int p) const {
     if (p < 0) return Z;
+    return D.get(0, p) * T((long long)p + 1) - E.get(0, p);
+  }
+};
+
+// Zero-indexed D-dimensional Fenwick Tree over a dims[0] x ... grid,
+// e.g. FenwickND<long long, 2> t({rows, cols}); t.add({x, y}, 5);
+// get(lo, hi) sums the box lo..hi (inclusive) from 2^D prefix sums.
+template <typename T = long long, int D = 2>
+class FenwickND {
+public:
+  FenwickND(const int (&dims)[D], T zero = T(0LL)) {
+    size = 1;
+    for (int d = 0; d < D; ++d) {
+      N[d] = dims[d];
+      size *= N[d];
+    }
+    S = new T[size];
+    Z = zero;
+    std::fill_n(S, size, Z);
+  }
+
+  ~FenwickND() { delete [] S; }
+
+  void add(const int (&index)[D], T delta) {
+    add(0, 0, index, delta);
+  }
+
+  T get(const int (&lo)[D], const int (&hi)[D]) const {
+    T plus = Z, minus = Z;
+    for (int mask = 0; mask < (1 << D); ++mask) {
+      int corner[D];
+      bool empty = false;
+      for (int d = 0; d < D; ++d) {
+        corner[d] = mask >> d & 1 ? lo[d] - 1 : hi[d];
+        empty |= corner[d] < 0;
+      }
+      if (empty) continue;
+      if (__builtin_parity(mask)) {
+        minus += sum(0, 0, corner);
+      } else {
+        plus += sum(0, 0, corner);
+      }
+    }
+    return plus - minus;
+  }
+
+private:
+  int N[D];
+  int64_t size;
+  T* S;
+  T Z;
+
+  // One-indexed walks along dimension d, below the flat row base.
+  void add(int d, int64_t base, const int* index, const T &delta) {
+    for (int i = index[d] + 1; i <= N[d]; i += i & -i) {
+      int64_t at = base * N[d] + i - 1;
+      if (d + 1 == D) {
+        S[at] += delta;
+      } else {
+        add(d + 1, at, index, delta);
+      }
+    }
+  }
+
+  T sum(int d, int64_t base, const int* index) const {
+    T result = Z;
+    for (int i = index[d] + 1; i > 0; i -= i & -i) {
+      int64_t at = base * N[d] + i - 1;
+      result += d + 1 == D ? S[at] : sum(d + 1, at, index);
+    }
+    return result;
+  }
+};
+
+// Adds to an atomic without ordering: fetch_add for integers, a CAS loop
+// for floating point (no atomic fetch_add there before C++20).
+template <typename T>
+inline void atomic_add(std::atomic<T> &a, T delta, std::true_type) {
+  a.fetch_add(delta, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline void atomic_add(std::atomic<T> &a, T delta, std::false_type) {
+  T old = a.load(std::memory_order_relaxed);
+  while (!a.compare_exchange_weak(old, old + delta, std::memory_order_relaxed)) {}
+}
+
+// Zero-indexed Fenwick Tree for arithmetic T that any number of threads
+// may add to at once: every node update is a lock-free atomic add. A get
+// racing with adds sees each of them either entirely or not at all per
+// node, so it is exact once the writers are done.
+template <typename T = long long>
+class ConcurrentFenwick {
+  static_assert(std::is_arithmetic<T>::value, "ConcurrentFenwick needs an arithmetic T");
+public:
+  ConcurrentFenwick(int n) {
+    N = n;
+    S = new std::atomic<T>[N];
+    for (int i = 0; i < N; ++i) S[i].store(T(0), std::memory_order_relaxed);
+  }
+
+  ~ConcurrentFenwick() { delete [] S; }
+
+  void add(int index, T delta) {
+    if (!index) {
+      atomic_add(S[0], delta, std::is_integral<T>());
+      return;
+    }
+    while (index < N) {
+      atomic_add(S[index], delta, std::is_integral<T>());
+      index += index & -index;
+    }
+  }
+
+  T get(int left, int right) const {
+    return sum(right) - sum(left - 1);
+  }
+
+private:
+  int N;
+  std::atomic<T>* S;
+  T sum(int p) const {
+    if (p < 0) return T(0);
+    T result = S[p].load(std::memory_order_relaxed);
+    while (p) {
+      p -= p & -p;
+      result += S[p].load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+};
+
+// Zero-indexed Fenwick Tree for update-heavy workloads: every thread adds
+// to a shard of its own, and get sums the shards. A shard has one writer
+// at a time (a spin lock taken once per add), so its nodes are updated
+// with plain loads and stores instead of one locked add per node. Threads
+// are numbered in the order they first touch any sharded tree, and thread
+// t starts at shard t % K; since any shard can take any add, a thread
+// whose shard is busy moves on to the next free one instead of waiting.
+// With no more threads than shards, a thread only waits when all K
+// shards are taken. Costs shards * N elements.
+template <typename T = long long>
+class ShardedFenwick {
+  static_assert(std::is_arithmetic<T>::value, "ShardedFenwick needs an arithmetic T");
+public:
+  ShardedFenwick(int n, int shards = std::max(1u, std::thread::hardware_concurrency())) {
+    N = n;
+    K = shards;
+    shard = new Shard[K];
+    for (int k = 0; k < K; ++k) {
+      shard[k].S = new std::atomic<T>[N];
+      for (int i = 0; i < N; ++i) shard[k].S[i].store(T(0), std::memory_order_relaxed);
+    }
+  }
+
+  ~ShardedFenwick() {
+    for (int k = 0; k < K; ++k) delete [] shard[k].S;
+    delete [] shard;
+  }
+
+  void add(int index, T delta) {
+    Shard &s = acquire();
+    if (!index) {
+      bump(s.S[0], delta);
+    } else {
+      for (; index < N; index += index & -index) bump(s.S[index], delta);
+    }
+    s.busy.clear(std::memory_order_release);
+  }
+
+  T get(int left, int right) const {
+    return sum(right) - sum(left - 1);
+  }
+
+private:
+  // Padded so that two shards' locks never share a cache line.
+  struct Shard {
+    std::atomic<T>* S;
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+    char pad[64];
+  };
+
+  int N, K;
+  Shard* shard;
+
+  static int thread_slot() {
+    static std::atomic<int> next(0);
+    static thread_local int slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+  // Locks the first free shard from the thread's own one on. After a
+  // round of busy shards the thread pauses, and after SPINS rounds it
+  // yields its CPU, so that a preempted lock holder can run.
+  Shard &acquire() {
+    const int SPINS = 64;
+    int k = thread_slot() % K;
+    for (int round = 0;; ++round) {
+      for (int i = 0; i < K; ++i, k = k + 1 == K ? 0 : k + 1) {
+        if (!shard[k].busy.test_and_set(std::memory_order_acquire)) return shard[k];
+      }
+      if (round < SPINS) {
+        pause();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  // Only the lock holder writes, so no read-modify-write is needed.
+  static void bump(std::atomic<T> &a, T delta) {
+    a.store(a.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+  }
+
+  T sum(int p) const {
+    if (p < 0) return T(0);
+    T result = T(0);
+    for (int k = 0; k < K; ++k) {
+      const std::atomic<T>* S = shard[k].S;
+      int q = p;
+      result += S[q].load(std::memory_order_relaxed);
+      while (q) {
+        q -= q & -q;
+        result += S[q].load(std::memory_order_relaxed);
+      }
+    }
+    return result;
+  }
+};
+
+// Zero-indexed B-ary Fenwick Tree with the same add/get API, for arrays
+// much larger than the cache. Layer h splits the array into blocks of
+// B^h elements, B blocks to a 64-byte node, and keeps for every block the
+// sum of the blocks before it in its node. A prefix sum is then one load
+// per layer at an address that only depends on the index, so the
+// log_B(N) loads of a query are all in flight at once instead of a chain
+// of dependent ones. An update adds delta to the tail of one node per
+// layer, a masked SIMD add. Needs about N * B / (B - 1) elements.
+template <typename T = long long>
+class WideFenwick {
+public:
+  static const int B = sizeof(T) <= 32 ? 64 / sizeof(T) : 2;
+
+  WideFenwick(int n, T zero = T(0LL)) {
+    init(n, zero);
+  }
+
+  // Builds the tree over [first, last) in O(N), one layer at a time:
+  // layer 0 straight from the input, each layer above from the node
+  // totals of the one below.
+  template <typename It, typename = decltype(*std::declval<It&>())>
+  WideFenwick(It first, It last, T zero = T(0LL)) {
+    init(std::distance(first, last), zero);
+    std::vector<T> blocks, totals;
+    build_layer(S, first, N, blocks);
+    for (int h = 1; h < H; ++h) {
+      totals.clear();
+      build_layer(S + offset[h], blocks.begin(), blocks.size(), totals);
+      blocks.swap(totals);
+    }
+  }
+
+  ~WideFenwick() { delete [] buffer; }
+
+  void add(int index, T delta) {
+    unsigned block = index;
+    for (int h = 0; h < H; ++h, block /= B) {
+      add_tail(S + offset[h] + block / B * B, block % B, delta);
+    }
+  }
+
+  T get(int left, int right) const {
+    return sum(right + 1) - sum(left);
+  }
+
+private:
+  int N, H;
+  int64_t offset[64];
+  T* buffer;
+  T* S;
+  T Z;
+
+  void init(int n, T zero) {
+    N = n;
+    Z = zero;
+    // Prefix sums go up to N inclusive, so the top layer needs B^H > N.
+    H = 0;
+    int64_t total = 0;
+    for (int64_t blocks = (int64_t)N + 1; H == 0 || blocks > 1; blocks = (blocks + B - 1) / B) {
+      offset[H++] = total;
+      total += (blocks + B - 1) / B * B;
+    }
+    // Over-allocate by a node so every layer starts on a cache line.
+    buffer = new T[total + B];
+    std::fill_n(buffer, total + B, Z);
+    S = buffer;
+    if (64 % sizeof(T) == 0) {
+      S += (64 - (uintptr_t)buffer % 64) % 64 / sizeof(T);
+    }
+  }
+
+  // Writes the running sums of n blocks into a layer and appends the
+  // total of every node.
+  template <typename It>
+  void build_layer(T* layer, It blocks, size_t n, std::vector<T> &totals) {
+    for (size_t k = 0; k < n; k += B) {
+      T running = Z;
+      // The slot after the last block is read by sum(N).
+      for (size_t i = k; i < k + B && i <= n; ++i) {
+        layer[i] = running;
+        if (i < n) running += *blocks++;
+      }
+      totals.push_back(running);
+    }
+  }
+
+  // Sum of [0, p).
+  T sum(unsigned p) const {
     T result = S[p];
-    int mask;
-    while ( (mask = lowest_bit(p)) ) {
-      result += S[p -= mask];
+    for (int h = 1; h < H; ++h) {
+      result += S[offset[h] + (p /= B)];
     }
     return result;
   }
+
+  // Adds delta to the entries after slot k of a node; the loop runs over
+  // the whole node so it does not branch on k.
+  void add_tail(T* node, int k, const T &delta) const {
+    for (int i = 0; i < B; ++i) {
+      node[i] += i > k ? delta : Z;
+    }
+  }
 };
 
+#ifdef __AVX2__
+template <>
+inline void WideFenwick<long long>::add_tail(long long* node, int k, const long long &delta) const {
+  const __m256i kv = _mm256_set1_epi64x(k), dv = _mm256_set1_epi64x(delta);
+  __m256i *lo = (__m256i*)node, *hi = (__m256i*)(node + 4);
+  _mm256_store_si256(lo, _mm256_add_epi64(_mm256_load_si256(lo),
+      _mm256_and_si256(dv, _mm256_cmpgt_epi64(_mm256_setr_epi64x(0, 1, 2, 3), kv))));
+  _mm256_store_si256(hi, _mm256_add_epi64(_mm256_load_si256(hi),
+      _mm256_and_si256(dv, _mm256_cmpgt_epi64(_mm256_setr_epi64x(4, 5, 6, 7), kv))));
+}
+#endif
+
 #endif // __FENWICK_H__
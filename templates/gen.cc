@@ -0,0 +1,272 @@
+// Reproducible inputs for benchmarks: g++ -O2 gen.cc -o gen
+//   ./gen matrix ROWS COLS [--density=D] [--rank=R] [--bits=B] [--int] [--real] [--count=N] [--seed=S]
+//   ./gen bigint DIGITS [--count=N] [--signed] [--seed=S]
+// The output only depends on the arguments, so the same command line
+// gives the same data on every machine.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "rational.h"
+#include "cplx.h"
+#include "random.cc"
+
+using namespace std;
+
+typedef Rational<int64_t> Frac;
+typedef Complex<Frac> Entry;
+
+// What write_matrix() generates; see the usage below.
+struct MatrixSpec {
+  int rows, cols, rank, bits;
+  double density;
+  bool integer, real;
+};
+
+// Nonzero fraction with numerator and denominator of at most bits bits.
+Frac coefficient(RandomGenerator &g, const MatrixSpec &spec) {
+  uint64_t top = (1ULL << spec.bits) - 1;
+  int64_t num = 1 + g.bounded64(top);
+  if (g.next32() & 1) num = -num;
+  int64_t den = spec.integer ? 1 : 1 + g.bounded64(top);
+  return Frac(num, den);
+}
+
+Entry nonzero_entry(RandomGenerator &g, const MatrixSpec &spec) {
+  // 1: real, 2: imaginary, 3: both.
+  int parts = spec.real ? 1 : 1 + g.bounded(3);
+  Entry e;
+  if (parts & 1) e.real = coefficient(g, spec);
+  if (parts & 2) e.imag = coefficient(g, spec);
+  return e;
+}
+
+// Independence test for the rows of write_matrix(): rows are mapped to
+// GF(MOD) like gauss_cplx -m does (i to a square root of -1, MOD % 4 == 1)
+// and kept in echelon form there. Rows independent mod MOD are also
+// independent over Q(i).
+class ModBasis {
+public:
+  static const uint64_t MOD = 998244353;
+
+  ModBasis() : unit(pow_mod(3, (MOD - 1) / 4)) {}
+
+  // Takes row if it is independent of the rows taken so far.
+  bool add(const vector<Entry> &row) {
+    vector<uint64_t> x(row.size());
+    uint64_t re, im;
+    for (size_t j = 0; j < row.size(); ++j) {
+      if (!residue(row[j].real, re) || !residue(row[j].imag, im)) return false;
+      x[j] = (re + unit * im) % MOD;
+    }
+    // Products are below 2^60, so the sums are only reduced every LAZY
+    // rows; an entry is reduced on its own when it is a multiplier.
+    const int LAZY = 15;
+    int lazy = 0;
+    for (size_t k = 0; k < basis.size(); ++k) {
+      const uint64_t f = x[pivot[k]] % MOD;
+      if (!f) continue;
+      const vector<uint64_t> &b = basis[k];
+      for (size_t j = 0; j < x.size(); ++j) x[j] += (MOD - f) * b[j];
+      if (++lazy == LAZY) {
+        for (size_t j = 0; j < x.size(); ++j) x[j] %= MOD;
+        lazy = 0;
+      }
+    }
+    for (size_t j = 0; j < x.size(); ++j) x[j] %= MOD;
+    size_t c = 0;
+    while (c < x.size() && !x[c]) ++c;
+    if (c == x.size()) return false;
+    const uint64_t inv = pow_mod(x[c], MOD - 2);
+    for (size_t j = 0; j < x.size(); ++j) x[j] = x[j] * inv % MOD;
+    basis.push_back(x);
+    pivot.push_back(c);
+    return true;
+  }
+
+private:
+  uint64_t unit;
+  vector<vector<uint64_t> > basis;
+  vector<size_t> pivot;
+
+  static uint64_t pow_mod(uint64_t b, uint64_t e) {
+    uint64_t r = 1;
+    for (; e; e >>= 1, b = b * b % MOD) {
+      if (e & 1) r = r * b % MOD;
+    }
+    return r;
+  }
+
+  // False when MOD divides the denominator.
+  static bool residue(const Frac &f, uint64_t &r) {
+    uint64_t d = f.den % MOD;
+    if (!d) return false;
+    uint64_t n = (f.num % (int64_t)MOD + MOD) % MOD;
+    r = d == 1 ? n : n * pow_mod(d, MOD - 2) % MOD;
+    return true;
+  }
+};
+
+// The matrix is X * Y: the spec.rank rows of Y are random, with density
+// spec.density, and X takes each of them once and builds the other rows
+// as c1 * a + c2 * b for rows a and b of Y and units c1, c2 in
+// {1, -1, i, -i}. Those have up to twice the density and the bit height
+// of the rows of Y. Row k of Y always has a nonzero in a column of its
+// own, so that no row is empty, and a row that turns out dependent on the
+// previous ones is drawn again, so the rank is exactly spec.rank. Unlike
+// a triangular Y, a random one is well conditioned, so -f sees the same
+// rank. Rows are passed to emit shuffled.
+template <typename Emit>
+void generate_matrix(RandomGenerator &g, const MatrixSpec &spec, Emit emit) {
+  int rank = spec.rank, i, j;
+  vector<int> order(spec.cols);
+  iota(order.begin(), order.end(), 0);
+  g.shuffle(order.begin(), order.end());
+
+  vector<vector<Entry> > base(rank, vector<Entry>(spec.cols));
+  ModBasis independent;
+  for (i = 0; i < rank; ++i) {
+    do {
+      for (j = 0; j < spec.cols; ++j) {
+        bool nonzero = j == order[i] || g.uniform() < spec.density;
+        base[i][j] = nonzero ? nonzero_entry(g, spec) : Entry();
+      }
+    } while (!independent.add(base[i]));
+  }
+
+  vector<int> rows(spec.rows);
+  iota(rows.begin(), rows.end(), 0);
+  g.shuffle(rows.begin(), rows.end());
+
+  const Entry units[4] = {Entry(1), Entry(-1), Entry(0, 1), Entry(0, -1)};
+  vector<Entry> row(spec.cols);
+  for (int r : rows) {
+    if (r < rank) {
+      row = base[r];
+    } else if (rank) {
+      int a = g.bounded(rank), b = rank > 1 ? g.bounded(rank - 1) : a;
+      if (b >= a && rank > 1) ++b;
+      Entry ca = units[g.bounded(4)], cb = units[g.bounded(4)];
+      for (j = 0; j < spec.cols; ++j) {
+        row[j] = ca * base[a][j];
+        if (b != a) row[j] += cb * base[b][j];
+      }
+    } else {
+      row.assign(spec.cols, Entry());
+    }
+    emit(row);
+  }
+}
+
+// Matrices in the input format of gauss_cplx.cc: "rows cols", then the
+// entries row by row, written like Complex::str().
+void write_matrix(RandomGenerator &g, const MatrixSpec &spec) {
+  string line;
+  printf("%d %d\n", spec.rows, spec.cols);
+  generate_matrix(g, spec, [&](const vector<Entry> &row) {
+    line.clear();
+    for (size_t j = 0; j < row.size(); ++j) {
+      if (j) line += ' ';
+      line += row[j].str();
+    }
+    line += '\n';
+    fputs(line.c_str(), stdout);
+  });
+}
+
+// count decimal numbers of exactly digits digits, one per line, so that
+// consecutive lines pair up as operands.
+void write_bigints(RandomGenerator &g, int digits, int count, bool is_signed) {
+  string line;
+  char chunk[16];
+  for (int n = 0; n < count; ++n) {
+    line.clear();
+    if (is_signed && g.next32() & 1) line += '-';
+    line += (char)('1' + g.bounded(9));
+    int left = digits - 1;
+    for (; left >= 9; left -= 9) {
+      snprintf(chunk, sizeof(chunk), "%09u", g.bounded(1000000000));
+      line += chunk;
+    }
+    for (; left > 0; --left) line += (char)('0' + g.bounded(10));
+    line += '\n';
+    fputs(line.c_str(), stdout);
+  }
+}
+
+// Without main(), for tests that include this file.
+#ifndef GEN_NO_MAIN
+void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s matrix ROWS COLS [--density=D] [--rank=R] [--bits=B] [--int] [--real] [--count=N] [--seed=S]\n"
+                  "       %s bigint DIGITS [--count=N] [--signed] [--seed=S]\n", prog, prog);
+  fprintf(stderr, "  --density=D  fraction of nonzero entries in the independent rows (default 1)\n");
+  fprintf(stderr, "  --rank=R     number of independent rows (default min(ROWS, COLS))\n");
+  fprintf(stderr, "  --bits=B     bit height of numerators and denominators, 1 to 31 (default 8)\n");
+  fprintf(stderr, "  --int        integer entries\n");
+  fprintf(stderr, "  --real       no imaginary parts\n");
+  fprintf(stderr, "  --count=N    number of matrices or numbers (default 1 matrix, 2 numbers)\n");
+  fprintf(stderr, "  --signed     negative numbers half of the time\n");
+  fprintf(stderr, "  --seed=S     RandomGenerator seed (default 1)\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  bool is_matrix = argc >= 4 && !strcmp(argv[1], "matrix");
+  bool is_bigint = argc >= 3 && !strcmp(argv[1], "bigint");
+  if (!is_matrix && !is_bigint) usage(argv[0]);
+
+  MatrixSpec spec = {0, 0, -1, 8, 1.0, false, false};
+  int digits = 0, count = is_matrix ? 1 : 2, first = is_matrix ? 4 : 3;
+  bool is_signed = false;
+  uint64_t seed = 1;
+  if (is_matrix) {
+    spec.rows = atoi(argv[2]);
+    spec.cols = atoi(argv[3]);
+  } else {
+    digits = atoi(argv[2]);
+  }
+  for (int i = first; i < argc; ++i) {
+    if (is_matrix && !strncmp(argv[i], "--density=", 10)) {
+      spec.density = atof(argv[i] + 10);
+    } else if (is_matrix && !strncmp(argv[i], "--rank=", 7)) {
+      spec.rank = atoi(argv[i] + 7);
+    } else if (is_matrix && !strncmp(argv[i], "--bits=", 7)) {
+      spec.bits = atoi(argv[i] + 7);
+    } else if (is_matrix && !strcmp(argv[i], "--int")) {
+      spec.integer = true;
+    } else if (is_matrix && !strcmp(argv[i], "--real")) {
+      spec.real = true;
+    } else if (is_bigint && !strcmp(argv[i], "--signed")) {
+      is_signed = true;
+    } else if (!strncmp(argv[i], "--count=", 8)) {
+      count = atoi(argv[i] + 8);
+    } else if (!strncmp(argv[i], "--seed=", 7)) {
+      seed = strtoull(argv[i] + 7, NULL, 10);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  RandomGenerator g(seed);
+  if (is_bigint) {
+    if (digits < 1 || count < 0) usage(argv[0]);
+    write_bigints(g, digits, count, is_signed);
+    return 0;
+  }
+
+  // Entries of the dependent rows are sums of two fractions of up to
+  // bits bits, which must still fit in 64 bits.
+  if (spec.rank < 0) spec.rank = min(spec.rows, spec.cols);
+  if (spec.rows < 1 || spec.cols < 1 || spec.rank > min(spec.rows, spec.cols) ||
+      spec.bits < 1 || spec.bits > 31 || spec.density < 0 || spec.density > 1 || count < 0) {
+    usage(argv[0]);
+  }
+  for (int n = 0; n < count; ++n) write_matrix(g, spec);
+  return 0;
+}
+#endif
@@ -1,7 +1,134 @@
+#ifndef __RANDOM_CC__
+#define __RANDOM_CC__
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 class RandomGenerator {
 public:
   RandomGenerator(uint64_t seed = 0) : seed(seed), state(0) {}
   uint32_t next(uint32_t upper_bound = UINT32_MAX) {
+    advance();
+    return seed % upper_bound;
+  }
+
+  // Full-range raw output. The halves of the state are folded together
+  // like next() does, since the high half alone is far from uniform.
+  uint32_t next32() { advance(); return (seed >> 32) ^ seed; }
+  uint64_t next64() { uint64_t high = next32(); return high << 32 | next32(); }
+
+  // Uniform in [0, bound) without a division or the modulo bias of
+  // next(bound) (Lemire): the high half of x * bound, rejecting the
+  // (2^32 mod bound) low halves that would make some results more
+  // likely. The % only runs when the low half is below bound.
+  uint32_t bounded(uint32_t bound) {
+    uint64_t m = (uint64_t)next32() * bound;
+    if ((uint32_t)m < bound) {
+      uint32_t threshold = -bound % bound;
+      while ((uint32_t)m < threshold) m = (uint64_t)next32() * bound;
+    }
+    return m >> 32;
+  }
+
+  uint64_t bounded64(uint64_t bound) {
+    unsigned __int128 m = (unsigned __int128)next64() * bound;
+    if ((uint64_t)m < bound) {
+      uint64_t threshold = -bound % bound;
+      while ((uint64_t)m < threshold) m = (unsigned __int128)next64() * bound;
+    }
+    return m >> 64;
+  }
+
+  // Uniform in [0, 1) on a 2^-53 grid.
+  double uniform() { return (next64() >> 11) * 0x1.0p-53; }
+
+  // Standard normal by the Marsaglia-Tsang ziggurat: 128 layers of equal
+  // area, so almost every call is one draw, a compare and a multiply.
+  // Layer and value come from different bits of one 64-bit draw.
+  double normal() {
+    const Ziggurat &z = ziggurat();
+    for (;;) {
+      uint64_t u = next64();
+      int32_t h = u >> 32;
+      int i = u & 127;
+      if ((uint32_t)std::abs((int64_t)h) < z.k[i]) return h * z.w[i];
+      double x = h * z.w[i];
+      if (!i) {
+        // The tail beyond r, sampled by Marsaglia's exponential method.
+        double y;
+        do {
+          x = -std::log(1 - uniform()) / Ziggurat::R;
+          y = -std::log(1 - uniform());
+        } while (y + y < x * x);
+        return h > 0 ? Ziggurat::R + x : -Ziggurat::R - x;
+      }
+      if (z.f[i] + uniform() * (z.f[i - 1] - z.f[i]) < std::exp(-0.5 * x * x)) return x;
+    }
+  }
+
+  // Fisher-Yates over a random access range. The swap partners of the
+  // next 32 positions are drawn first and prefetched, so on large
+  // ranges the cache misses overlap instead of coming one at a time.
+  template <typename It>
+  void shuffle(It first, It last) {
+    uint64_t i = std::distance(first, last), j[32];
+    while (i > 1) {
+      int block = std::min<uint64_t>(32, i - 1);
+      for (int b = 0; b < block; ++b) {
+        j[b] = i - b <= UINT32_MAX ? bounded(i - b) : bounded64(i - b);
+        __builtin_prefetch(&first[j[b]], 1);
+      }
+      for (int b = 0; b < block; ++b, --i) std::swap(first[i - 1], first[j[b]]);
+    }
+  }
+
+  // Streams. The step counter enters every update, so generators whose
+  // counters stay in different windows of 2^40 steps never pass through
+  // the same state. jump() moves to the start of the next window, and
+  // split() hands out the whole next window, e.g. one per worker thread,
+  // and moves this generator on to the one after it.
+  static const uint64_t STREAM = 1ULL << 40;
+
+  void jump() { state = (state / STREAM + 1) * STREAM; }
+
+  RandomGenerator split() {
+    jump();
+    RandomGenerator stream(*this);
+    jump();
+    return stream;
+  }
+
+  // n values of next() from LANES interleaved streams: out[i] comes from
+  // lane i % LANES, where lane k is this generator moved k windows ahead.
+  // The lanes step in lockstep (AVX2 when available, with the same
+  // output either way), and afterwards this generator continues as lane 0
+  // would, from the window after the last lane.
+  static const int LANES = 8;
+
+  void fill(uint32_t* out, size_t n) {
+    RandomGenerator lane[LANES];
+    for (int k = 0; k < LANES; ++k) {
+      lane[k] = *this;
+      lane[k].state += k * STREAM;
+    }
+    size_t i = 0;
+#ifdef __AVX2__
+    i = fill_avx2(lane, out, n);
+#endif
+    for (; i < n; ++i) out[i] = lane[i % LANES].next();
+    seed = lane[0].seed;
+    state = (lane[0].state / STREAM + LANES) * STREAM;
+  }
+
+private:
+  uint64_t seed, state;
+
+  void advance() {
     uint64_t H = seed >> 32;
     uint64_t L = seed & UINT32_MAX;
 
@@ -29,9 +156,115 @@ public:
       seed = ((seed & 0x3333333333333333L) << 2) |
              ((seed >> 2) & 0x3333333333333333LL);
     }
+  }
 
-    return seed % upper_bound;
+  // Ziggurat tables for normal(): layer i accepts |h| < k[i] outright and
+  // scales by w[i]; f is the density at the layer edges.
+  struct Ziggurat {
+    static constexpr double R = 3.442619855899, V = 9.91256303526217e-3;
+    uint32_t k[128];
+    double w[128], f[128];
+
+    Ziggurat() {
+      const double m = 2147483648.0;
+      double d = R, t = d, q = V / std::exp(-0.5 * d * d);
+      k[0] = d / q * m;
+      k[1] = 0;
+      w[0] = q / m;
+      w[127] = d / m;
+      f[0] = 1;
+      f[127] = std::exp(-0.5 * d * d);
+      for (int i = 126; i >= 1; --i) {
+        d = std::sqrt(-2 * std::log(V / d + std::exp(-0.5 * d * d)));
+        k[i + 1] = d / t * m;
+        t = d;
+        f[i] = std::exp(-0.5 * d * d);
+        w[i] = d / m;
+      }
+    }
+  };
+
+  static const Ziggurat &ziggurat() {
+    static const Ziggurat z;
+    return z;
   }
-private:
-  uint64_t seed, state;
+
+#ifdef __AVX2__
+  // One step of next() on four lanes, with the counter already bumped
+  // to state. Lanes are whole windows apart, so they agree on the low
+  // counter bits the branches look at and differ only by a constant in
+  // the two counter products, passed in as bump and mask.
+  static __m256i step(__m256i s, uint64_t state, __m256i bump, __m256i mask) {
+    const __m256i low = _mm256_set1_epi64x(UINT32_MAX);
+    __m256i H = _mm256_srli_epi64(s, 32);
+    __m256i a = (state - 1) & 2 ? H : s, b = (state - 1) & 2 ? s : H;
+    s = _mm256_add_epi64(s, _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_set1_epi64x(498627377)),
+                                             _mm256_mul_epu32(_mm256_xor_si256(b, low), _mm256_set1_epi64x(694379069))));
+    s = _mm256_add_epi64(s, _mm256_add_epi64(_mm256_set1_epi64x(state * 2644400359), bump));
+    s = _mm256_xor_si256(s, _mm256_add_epi64(_mm256_set1_epi64x((state ^ UINT32_MAX) * 3669561283), mask));
+
+    H = _mm256_srli_epi64(s, 32);
+    a = state & 1 ? _mm256_xor_si256(H, low) : H;
+    b = state & 1 ? s : _mm256_xor_si256(s, low);
+    s = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_set1_epi64x(1257677461)),
+                         _mm256_mul_epu32(b, _mm256_set1_epi64x(864277937)));
+    s = _mm256_add_epi64(s, _mm256_set1_epi64x(16303300055571991331ULL));
+    if (state & 4) {
+      const __m256i m = _mm256_set1_epi64x(0x5555555555555555LL);
+      s = _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(s, m), 1),
+                          _mm256_and_si256(_mm256_srli_epi64(s, 1), m));
+    }
+    if (state & 8) {
+      const __m256i m = _mm256_set1_epi64x(0x3333333333333333LL);
+      s = _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(s, m), 2),
+                          _mm256_and_si256(_mm256_srli_epi64(s, 2), m));
+    }
+    return s;
+  }
+
+  // seed % UINT32_MAX on four lanes: 2^32 = 1 mod 2^32 - 1, so fold the
+  // halves twice and map 2^32 - 1 itself to 0.
+  static __m256i mod_max(__m256i s) {
+    const __m256i low = _mm256_set1_epi64x(UINT32_MAX);
+    __m256i t = _mm256_add_epi64(_mm256_and_si256(s, low), _mm256_srli_epi64(s, 32));
+    t = _mm256_add_epi64(_mm256_and_si256(t, low), _mm256_srli_epi64(t, 32));
+    return _mm256_andnot_si256(_mm256_cmpeq_epi64(t, low), t);
+  }
+
+  // Whole blocks of LANES values, leaving the lanes where the scalar
+  // loop would; returns how many values were written.
+  static size_t fill_avx2(RandomGenerator* lane, uint32_t* out, size_t n) {
+    size_t blocks = n / LANES;
+    if (!blocks) return 0;
+    __m256i bump[2], mask[2], s[2];
+    for (int v = 0; v < 2; ++v) {
+      uint64_t k[4] = {4ULL * v, 4ULL * v + 1, 4ULL * v + 2, 4ULL * v + 3};
+      bump[v] = _mm256_setr_epi64x(k[0] * STREAM * 2644400359, k[1] * STREAM * 2644400359,
+                                   k[2] * STREAM * 2644400359, k[3] * STREAM * 2644400359);
+      mask[v] = _mm256_setr_epi64x(k[0] * STREAM * 3669561283, k[1] * STREAM * 3669561283,
+                                   k[2] * STREAM * 3669561283, k[3] * STREAM * 3669561283);
+      s[v] = _mm256_setr_epi64x(lane[k[0]].seed, lane[k[1]].seed, lane[k[2]].seed, lane[k[3]].seed);
+    }
+    const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    uint64_t state = lane[0].state;
+    for (size_t b = 0; b < blocks; ++b) {
+      ++state;
+      s[0] = step(s[0], state, bump[0], mask[0]);
+      s[1] = step(s[1], state, bump[1], mask[1]);
+      __m256i r = _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(mod_max(s[0]), pack),
+                                            _mm256_permutevar8x32_epi32(mod_max(s[1]), pack), 0x20);
+      _mm256_storeu_si256((__m256i*)(out + b * LANES), r);
+    }
+    uint64_t seeds[LANES];
+    _mm256_storeu_si256((__m256i*)seeds, s[0]);
+    _mm256_storeu_si256((__m256i*)(seeds + 4), s[1]);
+    for (int k = 0; k < LANES; ++k) {
+      lane[k].seed = seeds[k];
+      lane[k].state += blocks;
+    }
+    return blocks * LANES;
+  }
+#endif
 };
+
+#endif // __RANDOM_CC__
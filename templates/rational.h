@@ -0,0 +1,378 @@
+// Exact rational numbers over an integer type I, kept reduced with a
+// positive denominator: Rational<int64_t>, Rational<__int128> or
+// Rational<BigInt> (include bigint.h first for the latter).
+
+#ifndef __RATIONAL_H__
+#define __RATIONAL_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Instrumentation hook, called with gcdCalls, lcmCalls, fracOps or
+// overflows. Define it before including this header to count them.
+#ifndef RATIONAL_COUNT
+#define RATIONAL_COUNT(event) ((void)0)
+#endif
+
+// Integer helpers. The generic versions only use arithmetic and compare
+// against I(0) explicitly: BigInt converts implicitly to bool, int and
+// long long, so mixed expressions like a < 0 would be ambiguous.
+template <typename I>
+inline bool int_is_zero(const I &a) { return a == I(0); }
+
+template <typename I>
+inline I int_abs(const I &a) { return a < I(0) ? -a : a; }
+
+template <typename I>
+inline I int_gcd(I a, I b) {
+  RATIONAL_COUNT(gcdCalls);
+  a = int_abs(a); b = int_abs(b);
+  while (!int_is_zero(b)) {
+    I c = a % b; a = b; b = c;
+  }
+  return a;
+}
+
+// Stein's binary gcd: shifts and subtractions instead of divisions.
+inline uint64_t binary_gcd(uint64_t x, uint64_t y) {
+  if (!x || !y) return x | y;
+  int k = __builtin_ctzll(x | y);
+  x >>= __builtin_ctzll(x);
+  do {
+    y >>= __builtin_ctzll(y);
+    if (x > y) swap(x, y);
+    y -= x;
+  } while (y);
+  return x << k;
+}
+
+template <>
+inline int64_t int_gcd(int64_t a, int64_t b) {
+  RATIONAL_COUNT(gcdCalls);
+  return binary_gcd(a < 0 ? -(uint64_t)a : a, b < 0 ? -(uint64_t)b : b);
+}
+
+inline int int_bits(int64_t a) {
+  uint64_t u = a < 0 ? -(uint64_t)a : a;
+  return u ? 64 - __builtin_clzll(u) : 0;
+}
+
+inline long double int_val(int64_t a) { return a; }
+
+// Decimal digits of |a| written backwards from p, with the sign.
+template <typename U>
+inline char *int_digits(char *p, U u, bool neg) {
+  *--p = 0;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (neg) *--p = '-';
+  return p;
+}
+
+inline string int_str(int64_t a) {
+  char buf[24];
+  return int_digits(buf + sizeof(buf), a < 0 ? -(uint64_t)a : a, a < 0);
+}
+
+// __int128 division is a library call, so the gcd switches to the
+// 64-bit binary gcd as soon as both operands fit.
+template <>
+inline __int128 int_gcd(__int128 a, __int128 b) {
+  RATIONAL_COUNT(gcdCalls);
+  a = int_abs(a); b = int_abs(b);
+  while (b && (a >> 63 || b >> 63)) {
+    __int128 c = a % b; a = b; b = c;
+  }
+  if (!b) return a;
+  return binary_gcd(a, b);
+}
+
+inline int int_bits(__int128 a) {
+  unsigned __int128 u = a < 0 ? -(unsigned __int128)a : a;
+  uint64_t hi = u >> 64, lo = u;
+  return hi ? 128 - __builtin_clzll(hi) : lo ? 64 - __builtin_clzll(lo) : 0;
+}
+
+inline long double int_val(__int128 a) { return a; }
+
+inline string int_str(__int128 a) {
+  char buf[48];
+  return int_digits(buf + sizeof(buf), a < 0 ? -(unsigned __int128)a : a, a < 0);
+}
+
+#ifdef __BIGINT_H__
+// BigInt keeps a sign on zero after negation, so zero is tested on the
+// magnitude.
+template <>
+inline bool int_is_zero(const BigInt &a) { return !(bool)a; }
+
+inline int int_bits(const BigInt &a) { return int_is_zero(a) ? 0 : a.log2() + 1; }
+
+inline long double int_val(const BigInt &a) {
+  int shift = max(0, a.log2() - 62);
+  return ldexpl((long double)(long long)(a >> shift), shift);
+}
+
+inline string int_str(const BigInt &a) {
+  BigInt t(a);
+  return t.str();
+}
+#endif
+
+template <typename I>
+class Rational {
+public:
+  I num, den;
+
+  Rational(const I &a = I(0), const I &b = I(1)) : num(a), den(b) { simp(); }
+
+  template <typename J>
+  explicit Rational(const Rational<J> &r) : num(I(r.num)), den(I(r.den)) {}
+
+  const Rational & operator+=(const Rational &rhs) { add(rhs.num, rhs.den); return *this; }
+  const Rational & operator-=(const Rational &rhs) { add(-rhs.num, rhs.den); return *this; }
+  const Rational & operator*=(const Rational &rhs) { mul(rhs.num, rhs.den); return *this; }
+
+  const Rational & operator/=(const Rational &rhs) {
+    assert(!rhs.isZero());
+    if (rhs.num < I(0)) mul(-rhs.den, -rhs.num); else mul(rhs.den, rhs.num);
+    return *this;
+  }
+
+  const Rational operator+(const Rational &rhs) const { Rational r(*this); return r += rhs; }
+  const Rational operator-(const Rational &rhs) const { Rational r(*this); return r -= rhs; }
+  const Rational operator*(const Rational &rhs) const { Rational r(*this); return r *= rhs; }
+  const Rational operator/(const Rational &rhs) const { Rational r(*this); return r /= rhs; }
+
+  const Rational operator-() const { Rational r(*this); if (!isZero()) r.num = -r.num; return r; }
+  const Rational abs() const { return num < I(0) ? -*this : *this; }
+
+  // Both sides are reduced, so equality is on the representation.
+  bool operator==(const Rational &rhs) const { return num == rhs.num && den == rhs.den; }
+  bool operator!=(const Rational &rhs) const { return !(*this == rhs); }
+  bool operator<(const Rational &rhs) const { return cmp(rhs) < 0; }
+  bool operator>(const Rational &rhs) const { return cmp(rhs) > 0; }
+  bool operator<=(const Rational &rhs) const { return cmp(rhs) <= 0; }
+  bool operator>=(const Rational &rhs) const { return cmp(rhs) >= 0; }
+
+  bool isZero() const { return int_is_zero(num); }
+
+  // Bit height: the bit length of the larger of |num| and den.
+  int bits() const { return max(int_bits(num), int_bits(den)); }
+
+  long double val() const { return int_val(num) / int_val(den); }
+
+  const string str() const {
+    string r = int_str(num);
+    if (den != I(1)) {
+      r += '/';
+      r += int_str(den);
+    }
+    return r;
+  }
+
+  char * c_str() const { return strdup(str().c_str()); }
+
+private:
+  // Both operations take a reduced n / d with d > 0 and keep *this
+  // reduced without a full gcd of the result (Henrici).
+
+  // With g = gcd(den, d), num/den + n/d = t / (den/g * d) where
+  // t = num * (d/g) + n * (den/g), and only gcd(t, g) can be left in
+  // common. Equal denominators are the case g = den.
+  void add(const I &n, const I &d) {
+    RATIONAL_COUNT(fracOps);
+    I g = den;
+    if (den != d) {
+      RATIONAL_COUNT(lcmCalls);
+      g = int_gcd(den, d);
+    }
+    I b = den / g, t = num * (d / g) + n * b;
+    if (int_is_zero(t)) {
+      num = I(0); den = I(1);
+      return;
+    }
+    if (g != I(1)) g = int_gcd(t, g);
+    num = t / g;
+    den = b * (d / g);
+  }
+
+  // Only gcd(num, d) and gcd(n, den) can cancel, and they are gcds of
+  // the smaller operands.
+  void mul(const I &n, const I &d) {
+    RATIONAL_COUNT(fracOps);
+    if (isZero()) return;
+    if (int_is_zero(n)) {
+      num = I(0); den = I(1);
+      return;
+    }
+    I g1 = d == I(1) ? I(1) : int_gcd(num, d), g2 = den == I(1) ? I(1) : int_gcd(n, den);
+    num = (num / g1) * (n / g2);
+    den = (den / g2) * (d / g1);
+  }
+
+  int cmp(const Rational &rhs) const {
+    I a = num * rhs.den, b = rhs.num * den;
+    return a < b ? -1 : b < a ? 1 : 0;
+  }
+
+  void simp() {
+    if (int_is_zero(num)) {
+      num = I(0); den = I(1);
+      return;
+    }
+    if (den == I(1)) return;
+    if (den < I(0)) {
+      den = -den; num = -num;
+    }
+    I g = int_gcd(num, den);
+    if (g != I(1)) {
+      num /= g; den /= g;
+    }
+  }
+
+  void narrow(__int128 n, __int128 d);
+};
+
+// Thrown by Rational<int64_t> and Rational<__int128> when a result does
+// not fit in I. The caller can redo the computation at a wider I, up to
+// Rational<BigInt>, which never throws.
+struct RationalOverflow : overflow_error {
+  RationalOverflow() : overflow_error("rational overflow") {}
+};
+
+// The most negative value is kept out of num, so that negation is safe.
+inline bool int_is_min(int64_t a) { return a == INT64_MIN; }
+inline bool int_is_min(__int128 a) { return (unsigned __int128)a == (unsigned __int128)1 << 127; }
+
+// The Henrici steps on a native I, checking every product and sum. They
+// return false, and leave num and den unchanged, when something
+// overflows.
+template <typename I>
+inline bool native_add(I &num, I &den, const I &n, const I &d) {
+  RATIONAL_COUNT(fracOps);
+  I g = den, x, y, t, q;
+  if (den != d) {
+    RATIONAL_COUNT(lcmCalls);
+    g = int_gcd(den, d);
+  }
+  const I b = den / g, e = d / g;
+  if (__builtin_mul_overflow(num, e, &x) | __builtin_mul_overflow(n, b, &y) |
+      __builtin_add_overflow(x, y, &t) | __builtin_mul_overflow(b, d, &q) || int_is_min(t)) {
+    return false;
+  }
+  if (!t) {
+    num = 0; den = 1;
+    return true;
+  }
+  if (g != 1) g = int_gcd(t, g);
+  num = t / g; den = q / g;
+  return true;
+}
+
+template <typename I>
+inline bool native_mul(I &num, I &den, const I &n, const I &d) {
+  RATIONAL_COUNT(fracOps);
+  if (!num || !n) {
+    num = 0; den = 1;
+    return true;
+  }
+  const I g1 = d == 1 ? 1 : int_gcd(num, d), g2 = den == 1 ? 1 : int_gcd(n, den);
+  const I a = num / g1, b = n / g2, c = den / g2, e = d / g1;
+  I p, q;
+  if (__builtin_mul_overflow(a, b, &p) | __builtin_mul_overflow(c, e, &q) || int_is_min(p)) return false;
+  num = p; den = q;
+  return true;
+}
+
+// Sign of a/b - c/d for b, d > 0 without forming a*d or c*b: the integer
+// parts are compared first, then the reciprocals of the fractional parts,
+// as in a continued fraction expansion.
+template <typename I>
+inline int frac_cmp(I a, I b, I c, I d) {
+  for (;;) {
+    I p = a / b, r = a % b, q = c / d, s = c % d;
+    if (r < 0) { r += b; --p; }
+    if (s < 0) { s += d; --q; }
+    if (p != q) return p < q ? -1 : 1;
+    if (!r || !s) return r ? 1 : s ? -1 : 0;
+    // r/b < s/d exactly when d/s < b/r.
+    I t = b;
+    a = d; b = s; c = t; d = r;
+  }
+}
+
+// int64_t: an operation that overflows is redone in __int128 and
+// reduced, so only a result that does not fit in 64 bits after reduction
+// throws.
+template <>
+inline void Rational<int64_t>::narrow(__int128 n, __int128 d) {
+  __int128 g = int_gcd(n, d);
+  if (g != 1) {
+    n /= g; d /= g;
+  }
+  if (d < 0) {
+    n = -n; d = -d;
+  }
+  if (n != (int64_t)n || d != (int64_t)d || int_is_min((int64_t)n)) {
+    RATIONAL_COUNT(overflows);
+    throw RationalOverflow();
+  }
+  num = n; den = d;
+}
+
+template <>
+inline void Rational<int64_t>::add(const int64_t &n, const int64_t &d) {
+  if (!native_add(num, den, n, d)) narrow((__int128)num * d + (__int128)n * den, (__int128)den * d);
+}
+
+template <>
+inline void Rational<int64_t>::mul(const int64_t &n, const int64_t &d) {
+  if (!native_mul(num, den, n, d)) narrow((__int128)num * n, (__int128)den * d);
+}
+
+template <>
+inline int Rational<int64_t>::cmp(const Rational<int64_t> &rhs) const {
+  __int128 a = (__int128)num * rhs.den, b = (__int128)rhs.num * den;
+  return a < b ? -1 : b < a ? 1 : 0;
+}
+
+// __int128 has no wider native type, so an operation that overflows an
+// intermediate throws right away.
+template <>
+inline void Rational<__int128>::add(const __int128 &n, const __int128 &d) {
+  if (!native_add(num, den, n, d)) {
+    RATIONAL_COUNT(overflows);
+    throw RationalOverflow();
+  }
+}
+
+template <>
+inline void Rational<__int128>::mul(const __int128 &n, const __int128 &d) {
+  if (!native_mul(num, den, n, d)) {
+    RATIONAL_COUNT(overflows);
+    throw RationalOverflow();
+  }
+}
+
+template <>
+inline int Rational<__int128>::cmp(const Rational<__int128> &rhs) const {
+  __int128 a, b;
+  if (__builtin_mul_overflow(num, rhs.den, &a) | __builtin_mul_overflow(rhs.num, den, &b)) {
+    return frac_cmp(num, den, rhs.num, rhs.den);
+  }
+  return a < b ? -1 : b < a ? 1 : 0;
+}
+
+#endif // __RATIONAL_H__
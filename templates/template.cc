@@ -16,6 +16,8 @@
 #include <utility>
 #include <vector>
 
+#include "fastio.h"
+
 using namespace std;
 
 #ifdef _DEBUG_MODE_
@@ -52,6 +54,7 @@ int main() {
   _main();
   // COUNTER CODE ENDS HERE
 
+  fast_out.flush();
   return 0;
 }
 
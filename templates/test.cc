@@ -1,15 +1,27 @@
 #include "bigint.h"
 #include "fenwick.h"
+#include "rational.h"
+#include "cplx.h"
+#include "fastio.h"
+#include "random.cc"
+#define GEN_NO_MAIN
+#include "gen.cc"
 
-template <typename T>
-void assert_fenwick_range(const Fenwick<T> &t, int left, int right, const T &expected) {
+#include <climits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+template <typename Tree, typename T>
+void assert_fenwick_range(const Tree &t, int left, int right, const T &expected) {
   T r = t.get(left, right);
   cout << ( ( r == expected ) ? "PASS" : "FAIL" ) << ": Fenwick[" << left << ".." << right << "] = " << r << ", expected " << expected << endl;
 }
 
-template <typename T>
+template <template <typename...> class Tree, typename T>
 void test_fenwick() {
-  Fenwick<T> fenwick(100000);
+  Tree<T> fenwick(100000);
   for (int i = 0; i < 100000; ++i) {
     fenwick.add(i, i + 1);
   }
@@ -30,6 +42,215 @@ void test_fenwick() {
   assert_fenwick_range(fenwick, 0, 99999, T(4449984999));
 }
 
+template <typename T>
+void test_range_fenwick() {
+  RangeFenwick<T> fenwick(100000);
+  for (int i = 0; i < 100000; ++i) {
+    fenwick.add(i, i + 1);
+  }
+  assert_fenwick_range(fenwick, 0, 99999, T(5000050000));
+
+  // The zeroing above as one range update on top of a constant.
+  fenwick.add(0, 99999, T(2));
+  fenwick.add(50000, 60000, T(-2));
+  assert_fenwick_range(fenwick, 50000, 60000, T(550065001));
+  assert_fenwick_range(fenwick, 49999, 60001, T(550175007));
+  assert_fenwick_range(fenwick, 0, 99999, T(5000229998));
+  assert_fenwick_range(fenwick, 99999, 99999, T(100002));
+}
+
+// Random box updates and queries against a plain grid.
+template <int D>
+void test_fenwick_nd(const int (&dims)[D]) {
+  FenwickND<long long, D> fenwick(dims);
+  int size = 1;
+  for (int d = 0; d < D; ++d) size *= dims[d];
+  vector<long long> naive(size);
+  mt19937 rng(D);
+  bool ok = true;
+  for (int k = 0; k < 500 && ok; ++k) {
+    int at[D], lo[D], hi[D];
+    int flat = 0;
+    for (int d = 0; d < D; ++d) {
+      at[d] = rng() % dims[d];
+      flat = flat * dims[d] + at[d];
+      lo[d] = rng() % dims[d];
+      hi[d] = rng() % dims[d];
+      if (lo[d] > hi[d]) swap(lo[d], hi[d]);
+    }
+    long long delta = (long long)(rng() % 2001) - 1000;
+    fenwick.add(at, delta);
+    naive[flat] += delta;
+    long long expected = 0;
+    for (int i = 0; i < size; ++i) {
+      bool inside = true;
+      for (int d = D - 1, r = i; d >= 0; r /= dims[d--]) {
+        inside &= lo[d] <= r % dims[d] && r % dims[d] <= hi[d];
+      }
+      if (inside) expected += naive[i];
+    }
+    ok = fenwick.get(lo, hi) == expected;
+  }
+  cout << (ok ? "PASS" : "FAIL") << ": FenwickND<" << D << "> random boxes" << endl;
+}
+
+// Trees built in O(N) and batched calls against point adds.
+template <typename T>
+void test_fenwick_bulk() {
+  const int n = 100000;
+  vector<T> values;
+  for (int i = 0; i < n; ++i) values.push_back(T(i + 1));
+  Fenwick<T> fenwick(values.begin(), values.end());
+  assert_fenwick_range(fenwick, 0, 99999, T(5000050000));
+  assert_fenwick_range(fenwick, 50000, 60000, T(550065001));
+  WideFenwick<T> wide(values.begin(), values.end());
+  assert_fenwick_range(wide, 0, 99999, T(5000050000));
+  assert_fenwick_range(wide, 50000, 60000, T(550065001));
+
+  // Two sparse batches and a dense one, then 1000 ranges in one call.
+  mt19937 rng(3);
+  for (int count : {100, 20000, 40000}) {
+    vector<int> index;
+    vector<T> delta;
+    for (int i = 0; i < count; ++i) {
+      index.push_back(rng() % n);
+      delta.push_back(T((long long)(rng() % 1000)));
+    }
+    fenwick.add_many(index.data(), delta.data(), count);
+    for (int i = 0; i < count; ++i) wide.add(index[i], delta[i]);
+  }
+  vector<int> left, right;
+  for (int i = 0; i < 1000; ++i) {
+    int l = rng() % n, r = rng() % n;
+    left.push_back(min(l, r));
+    right.push_back(max(l, r));
+  }
+  vector<T> out(1000, T(0LL));
+  fenwick.get_many(left.data(), right.data(), out.data(), 1000);
+  bool ok = true;
+  for (int i = 0; i < 1000; ++i) ok = ok && out[i] == wide.get(left[i], right[i]);
+  cout << (ok ? "PASS" : "FAIL") << ": add_many/get_many match point updates" << endl;
+
+  // Repeated indices and node 0 in a sparse batch.
+  Fenwick<T> small(1000);
+  const int index[] = {6, 0, 5, 0, 6, 999};
+  const T delta[] = {T(1), T(2), T(3), T(4), T(5), T(6)};
+  small.add_many(index, delta, 6);
+  assert_fenwick_range(small, 0, 0, T(6));
+  assert_fenwick_range(small, 1, 6, T(9));
+  assert_fenwick_range(small, 0, 999, T(21));
+
+  // The same batch is dense on a tree of 7 elements.
+  Fenwick<T> tiny(7);
+  const int tiny_index[] = {6, 0, 5, 0, 6, 3};
+  tiny.add_many(tiny_index, delta, 6);
+  assert_fenwick_range(tiny, 0, 0, T(6));
+  assert_fenwick_range(tiny, 1, 6, T(15));
+  assert_fenwick_range(tiny, 4, 5, T(3));
+}
+
+// lower_bound against a linear scan of the prefix sums, with zero weights.
+template <typename I>
+void test_fenwick_lower_bound() {
+  mt19937 rng(41);
+  bool ok = true;
+  for (int n : {1, 2, 3, 17, 64, 1000}) {
+    vector<long long> weight(n);
+    for (auto &w : weight) w = rng() % 3 ? rng() % 10 : 0;
+    Fenwick<long long, I> fenwick(weight.begin(), weight.end());
+    long long total = accumulate(weight.begin(), weight.end(), 0LL);
+    for (long long target = 0; target <= total + 1; ++target) {
+      I expected = 0;
+      long long prefix = weight[0];
+      while (expected < n && prefix < target) prefix += ++expected < n ? weight[expected] : 0;
+      ok = ok && fenwick.lower_bound(target) == expected;
+    }
+  }
+  cout << (ok ? "PASS" : "FAIL") << ": lower_bound matches a linear scan" << endl;
+
+  // Order statistics over a 0/1 presence tree.
+  Fenwick<long long, I> present(1 << 20);
+  for (I i = 7; i < (1 << 20); i += 1000) present.add(i, 1);
+  cout << (present.lower_bound(1) == 7 && present.lower_bound(500) == 499007 &&
+           present.lower_bound(2000) == (1 << 20) ? "PASS" : "FAIL") << ": lower_bound order statistics" << endl;
+}
+
+// A file-backed tree matches the heap one, and reopens as it was left.
+void test_mapped_fenwick() {
+  typedef Fenwick<long long, int64_t, MappedStorage<long long, int64_t> > Mapped;
+  const string path = "/tmp/fenwick_test_" + to_string(getpid()) + ".fw";
+  const int n = 100000;
+  vector<long long> values;
+  for (int i = 0; i < n; ++i) values.push_back(i + 1);
+  {
+    Mapped fenwick(values.begin(), values.end(), 0LL, path);
+    assert_fenwick_range(fenwick, 0, 99999, 5000050000LL);
+    for (int i = 50000; i <= 60000; ++i) fenwick.add(i, -fenwick.get(i, i));
+    fenwick.add(0, 7);
+    fenwick.sync();
+  }
+  {
+    Mapped fenwick(n, 0LL, path);
+    assert_fenwick_range(fenwick, 0, 99999, 4449985006LL);
+    assert_fenwick_range(fenwick, 50000, 60000, 0LL);
+    cout << (fenwick.lower_bound(5000000) == 3161 ? "PASS" : "FAIL") << ": reopened lower_bound" << endl;
+  }
+  bool rejected = false;
+  try {
+    Mapped other(n + 1, 0LL, path);
+  } catch (const runtime_error &e) {
+    rejected = true;
+  }
+  cout << (rejected ? "PASS" : "FAIL") << ": reopening with another size throws" << endl;
+  unlink(path.c_str());
+
+  // -0.0 is a zero that is not all zero bytes, so it is written out.
+  {
+    Fenwick<double, int, MappedStorage<double> > real(1000, -0.0, path);
+    real.add(10, 0.5);
+    cout << (real.get(0, 999) == 0.5 && real.get(11, 999) == 0 ? "PASS" : "FAIL") << ": MappedStorage with zero = -0.0" << endl;
+  }
+  unlink(path.c_str());
+}
+
+// Writers on several threads, then the totals of the single-threaded test.
+template <typename Tree>
+void test_concurrent_fenwick(Tree &fenwick, const string &name) {
+  vector<thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.push_back(thread([&fenwick, t] {
+      for (int i = t; i < 100000; i += 4) fenwick.add(i, i + 1);
+    }));
+  }
+  for (auto &w : writers) w.join();
+  long long all = fenwick.get(0, 99999), part = fenwick.get(50000, 60000);
+  cout << (all == 5000050000LL && part == 550065001LL ? "PASS" : "FAIL") << ": " << name
+       << " with 4 writers, [0..99999] = " << all << ", [50000..60000] = " << part << endl;
+}
+
+// Random updates and ranges against a plain array, around layer sizes.
+void test_wide_fenwick_sizes() {
+  const int sizes[] = {1, 7, 8, 9, 63, 64, 65, 511, 512, 513, 4097};
+  mt19937 rng(7);
+  for (int n : sizes) {
+    vector<long long> naive(n);
+    for (int i = 0; i < n; ++i) naive[i] = rng() % 100;
+    WideFenwick<long long> wide(naive.begin(), naive.end());
+    bool ok = true;
+    for (int k = 0; k < 2000 && ok; ++k) {
+      int i = rng() % n, j = rng() % n;
+      long long delta = (long long)(rng() % 2000001) - 1000000;
+      wide.add(i, delta);
+      naive[i] += delta;
+      if (i > j) swap(i, j);
+      long long expected = 0;
+      for (int t = i; t <= j; ++t) expected += naive[t];
+      ok = wide.get(i, j) == expected && wide.get(0, n - 1) == accumulate(naive.begin(), naive.end(), 0LL);
+    }
+    cout << (ok ? "PASS" : "FAIL") << ": WideFenwick(" << n << ") random ranges" << endl;
+  }
+}
+
 void assert_sqrt(const BigInt& base, const BigInt &extra) {
   BigInt square = base * base + extra;
   pair<BigInt, BigInt> result = square.sqrt2();
@@ -57,19 +278,390 @@ void assert_equals(const BigInt& a, const BigInt& b) {
   cout << (a == b ? "PASS" : "FAIL") << ": a = " << a << ", b = " << b << endl;
 }
 
+void assert_str(const string &s, const string &expected) {
+  cout << (s == expected ? "PASS" : "FAIL") << ": " << s << ", expected " << expected << endl;
+}
+
+template <typename T>
+void assert_str(const T &v, const string &expected) { assert_str(v.str(), expected); }
+
+template <typename I>
+void test_rational() {
+  typedef Rational<I> Q;
+  assert_str(Q(I(1), I(2)) + Q(I(1), I(3)), "5/6");
+  assert_str(Q(I(1), I(6)) - Q(I(2), I(3)), "-1/2");
+  assert_str(Q(I(4), I(-6)), "-2/3");
+  assert_str(Q(I(3), I(4)) / Q(I(-9), I(2)), "-1/6");
+  assert_str(Q(I(5), I(7)) - Q(I(5), I(7)), "0");
+  assert_str(-Q(I(0)), "0");
+  cout << ((Q(I(-1), I(3)) < Q(I(-1), I(4))) ? "PASS" : "FAIL") << ": -1/3 < -1/4" << endl;
+  cout << ((-Q(I(0)) == Q(I(0))) ? "PASS" : "FAIL") << ": -0 == 0" << endl;
+}
+
+void test_rational_width() {
+  // Intermediate products overflow 64 bits, the reduced results do not.
+  typedef Rational<int64_t> Q;
+  assert_str(Q(1LL << 62, 3) * Q(3, 1LL << 61), "2");
+  assert_str(Q(1LL << 62, 3) + Q(1LL << 62, 6), "2305843009213693952");
+  typedef Rational<__int128> Q128;
+  assert_str(Q128((__int128)1 << 62, 3) * Q128((__int128)1 << 62, 5), "21267647932558653966460912964485513216/15");
+  typedef Rational<BigInt> QB;
+  assert_str(QB(BigInt(1) << 200, BigInt(3)) / QB(BigInt(1) << 199, BigInt(6)), "4");
+}
+
+// Determinant of the n x n Hilbert matrix by fraction-exact elimination;
+// its denominator outgrows 64 bits at n = 7 and 128 bits at n = 9.
+template <typename I>
+string hilbert_det(int n) {
+  typedef Rational<I> Q;
+  vector<vector<Q> > a(n, vector<Q>(n));
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) a[i][j] = Q(I(1), I(i + j + 1));
+  }
+  Q det(I(1));
+  for (int k = 0; k < n; ++k) {
+    det *= a[k][k];
+    for (int i = k + 1; i < n; ++i) {
+      Q f = a[i][k] / a[k][k];
+      for (int j = k; j < n; ++j) a[i][j] -= f * a[k][j];
+    }
+  }
+  return det.str();
+}
+
+// Which of Rational<I> overflows, or its result when none does.
+template <typename I>
+string hilbert_det_or_overflow(int n) {
+  try {
+    return hilbert_det<I>(n);
+  } catch (const RationalOverflow &) {
+    return "overflow";
+  }
+}
+
+void test_rational_overflow() {
+  // Results that do not fit throw instead of wrapping around.
+  typedef Rational<int64_t> Q;
+  assert_str(hilbert_det_or_overflow<int64_t>(6), hilbert_det<BigInt>(6));
+  assert_str(hilbert_det_or_overflow<int64_t>(8), "overflow");
+  assert_str(hilbert_det_or_overflow<__int128>(8), hilbert_det<BigInt>(8));
+  assert_str(hilbert_det_or_overflow<__int128>(10), "overflow");
+  bool thrown = false;
+  try {
+    Q(INT64_MAX) + Q(1);
+  } catch (const RationalOverflow &) {
+    thrown = true;
+  }
+  cout << (thrown ? "PASS" : "FAIL") << ": INT64_MAX + 1 throws" << endl;
+
+  // Comparisons of Rational<__int128> whose cross products overflow.
+  typedef Rational<__int128> Q128;
+  const __int128 big = (__int128)1 << 125;
+  Q128 a(big * 2 - 1, big + 1), b(big * 2 - 3, big), c(-(big * 2 - 1), big + 1);
+  cout << ((b < a && a > b && c < b && !(a < a)) ? "PASS" : "FAIL") << ": wide Rational<__int128> compare" << endl;
+}
+
+// The __int128 gcd gets the same pair times 2^64, multiplied rather than
+// shifted since a left shift of a negative value is undefined.
+void assert_gcd(long long a, long long b, long long expected) {
+  const __int128 scale = (__int128)1 << 64;
+  long long g = int_gcd<int64_t>(a, b);
+  __int128 h = int_gcd<__int128>(a * scale, b * scale) / scale;
+  cout << (g == expected && h == expected ? "PASS" : "FAIL") << ": gcd(" << a << ", " << b << ") = " << g << endl;
+}
+
+void test_gcd() {
+  assert_gcd(0, 0, 0);
+  assert_gcd(0, -7, 7);
+  assert_gcd(-12, 18, 6);
+  assert_gcd(1LL << 40, 3LL << 35, 1LL << 35);
+  assert_gcd(1000000007LL * 998244353, 998244353LL * 3, 998244353);
+  // Henrici add/mul still leave a reduced result.
+  typedef Rational<int64_t> Q;
+  assert_str(Q(3, 10) + Q(1, 15), "11/30");
+  assert_str(Q(7, 12) + Q(5, 12), "1");
+  assert_str(Q(14, 15) * Q(25, 28), "5/6");
+}
+
+void test_random() {
+  // fill interleaves LANES streams, each next() of this generator moved
+  // k windows ahead, with the same output on the AVX2 and scalar paths.
+  const size_t n = 1003;
+  vector<uint32_t> out(n);
+  RandomGenerator g(12345), lane[RandomGenerator::LANES];
+  for (int k = 0; k < RandomGenerator::LANES; ++k) {
+    lane[k] = k ? lane[k - 1] : g;
+    if (k) lane[k].jump();
+  }
+  g.fill(out.data(), n);
+  bool ok = true;
+  uint64_t hash = 0;
+  for (size_t i = 0; i < n; ++i) {
+    ok = ok && out[i] == lane[i % RandomGenerator::LANES].next();
+    hash = hash * 1000003 + out[i];
+  }
+  cout << (ok ? "PASS" : "FAIL") << ": fill matches interleaved streams" << endl;
+  cout << (hash == 0x8a7f28a5381b79daULL ? "PASS" : "FAIL") << ": fill output for seed 12345 = " << hex << hash << dec << endl;
+
+  // split() hands out the next window whole and moves the parent past
+  // it, however far the parent got into its own window.
+  RandomGenerator parent(7), copy(7), after(7);
+  for (int i = 0; i < 100; ++i) parent.next(), copy.next(), after.next();
+  RandomGenerator child = parent.split();
+  copy.jump();
+  after.jump(); after.jump();
+  bool same = true, differ = false;
+  for (int i = 0; i < 100; ++i) {
+    uint32_t c = child.next(), p = parent.next();
+    same = same && c == copy.next() && p == after.next();
+    differ = differ || c != p;
+  }
+  cout << (same && differ ? "PASS" : "FAIL") << ": split streams" << endl;
+
+  // Statistical checks on fixed seeds; bounds are loose enough for any
+  // decent generator but catch a wrong distribution.
+  RandomGenerator r(2024);
+  const int draws = 1000000;
+  long long counts[10] = {0};
+  for (int i = 0; i < draws; ++i) ++counts[r.bounded(10)];
+  double chi2 = 0;
+  for (long long c : counts) chi2 += (c - draws / 10.0) * (c - draws / 10.0) / (draws / 10.0);
+  cout << (chi2 < 27.88 ? "PASS" : "FAIL") << ": bounded(10) chi-square " << chi2 << " < 27.88" << endl;
+
+  // 2^32 mod 3*2^30 = 2^30, so x % bound would put half the mass below
+  // 2^30 instead of a third.
+  int low = 0;
+  for (int i = 0; i < 100000; ++i) low += r.bounded(3U << 30) < (1U << 30);
+  cout << (abs(low / 100000.0 - 1 / 3.0) < 0.005 ? "PASS" : "FAIL") << ": bounded(3 * 2^30) is unbiased, "
+       << low / 100000.0 << " below 2^30" << endl;
+  bool in_range = true;
+  for (int i = 0; i < 1000; ++i) in_range = in_range && r.bounded64(1000000000000ULL) < 1000000000000ULL && r.bounded(1) == 0;
+  cout << (in_range ? "PASS" : "FAIL") << ": bounded ranges" << endl;
+
+  double sum = 0, sum2 = 0;
+  bool unit = true;
+  for (int i = 0; i < draws; ++i) {
+    double u = r.uniform();
+    unit = unit && 0 <= u && u < 1;
+    sum += u;
+  }
+  cout << (unit && abs(sum / draws - 0.5) < 0.002 ? "PASS" : "FAIL") << ": uniform mean " << sum / draws << endl;
+
+  sum = 0;
+  int beyond2 = 0, beyond35 = 0;
+  for (int i = 0; i < draws; ++i) {
+    double x = r.normal();
+    sum += x;
+    sum2 += x * x;
+    beyond2 += abs(x) > 2;
+    beyond35 += abs(x) > 3.5;
+  }
+  double mean = sum / draws, var = sum2 / draws - mean * mean;
+  // P(|x| > 2) = 0.0455, P(|x| > 3.5) = 0.000465 (past the ziggurat base).
+  cout << (abs(mean) < 0.005 && abs(var - 1) < 0.01 && abs(beyond2 - 45500) < 1000 && 350 < beyond35 && beyond35 < 600
+           ? "PASS" : "FAIL") << ": normal mean " << mean << ", variance " << var << ", tails " << beyond2 << " " << beyond35 << endl;
+
+  // Where element 0 lands after shuffling four.
+  long long where[4] = {0};
+  for (int i = 0; i < 100000; ++i) {
+    int a[4] = {0, 1, 2, 3};
+    r.shuffle(a, a + 4);
+    ++where[find(a, a + 4, 0) - a];
+  }
+  chi2 = 0;
+  for (long long c : where) chi2 += (c - 25000.0) * (c - 25000.0) / 25000.0;
+  cout << (chi2 < 16.27 ? "PASS" : "FAIL") << ": shuffle positions chi-square " << chi2 << " < 16.27" << endl;
+}
+
+// Values at the ends of each width, a BigInt, a token and a zero-padded
+// number longer than the buffers, written with FastOutput and read back
+// from a regular file (mmap) and from a pipe (block reads).
+void test_fastio() {
+  const string path = "/tmp/fastio_test_" + to_string(getpid()) + ".txt";
+  const string longest(100000, 'x');
+  const BigInt big(string("-123456789012345678901234567890"));
+  {
+    FILE *f = fopen(path.c_str(), "w");
+    FastOutput w(f);
+    w.write(INT_MIN, ' ', INT_MAX, '\n', LLONG_MIN, ' ', ULLONG_MAX, '\n', 0, " +7 ", string("word"), '\n');
+    w.write(big, ' ', longest, " z\n");
+    w.write('-', string(100000, '0'), "123456789\n");
+    w.write(true, ' ', false, '\n');
+    for (int i = -50000; i < 50000; ++i) w.write(i * 7919LL, i % 10 ? ' ' : '\n');
+    w.flush();
+    fclose(f);
+  }
+  for (int pass = 0; pass < 2; ++pass) {
+    FILE *f = pass ? popen(("cat " + path).c_str(), "r") : fopen(path.c_str(), "r");
+    FastInput r(f);
+    int a, b, zero, seven;
+    long long c;
+    unsigned long long d;
+    string word, text;
+    BigInt e;
+    char z;
+    long long padded;
+    bool yes = false, no = true;
+    bool ok = r.read(a, b, c, d, zero, seven, word) && r.read(e, text, z, padded, yes, no);
+    ok = ok && a == INT_MIN && b == INT_MAX && c == LLONG_MIN && d == ULLONG_MAX;
+    ok = ok && zero == 0 && seven == 7 && word == "word" && e == big && text == longest && z == 'z';
+    ok = ok && padded == -123456789 && yes && !no;
+    long long v;
+    for (int i = -50000; i < 50000; ++i) ok = ok && r.read(v) && v == i * 7919LL;
+    ok = ok && !r.read(v) && !r.read(word);
+    cout << (ok ? "PASS" : "FAIL") << ": FastOutput / FastInput round trip through a " << (pass ? "pipe" : "file") << endl;
+    if (pass) pclose(f); else fclose(f);
+  }
+  unlink(path.c_str());
+}
+
+void test_complex() {
+  typedef Rational<int64_t> Q;
+  typedef Complex<Q> C;
+  assert_str(C(Q(1), Q(1)) * C(Q(1), Q(-1)), "2");
+  assert_str(C(Q(1, 2), Q(-3, 4)), "1/2-(3/4)i");
+  assert_str(C(Q(0), Q(-1)), "-i");
+  assert_str(C(Q(2), Q(1)), "2+i");
+  assert_str(C(Q(3), Q(4)).inverse(), "3/25-(4/25)i");
+  assert_str(C(Q(3), Q(4)) / C(Q(3), Q(4)), "1");
+}
+
+// gen's matrices have exactly the requested rank, checked by exact
+// elimination over Q(i) on small sizes of every shape and density.
+void test_gen() {
+  typedef Complex<Rational<BigInt> > C;
+  const MatrixSpec specs[] = {
+    {12, 15, 9, 8, 0.3, false, false},
+    {20, 20, 20, 4, 1.0, false, false},
+    {15, 10, 7, 8, 1.0, true, false},
+    {25, 30, 25, 6, 0.1, true, true},
+    {18, 18, 0, 8, 1.0, false, false},
+  };
+  RandomGenerator g(45);
+  for (const MatrixSpec &spec : specs) {
+    vector<vector<C> > a;
+    generate_matrix(g, spec, [&](const vector<Entry> &row) {
+      a.push_back(vector<C>());
+      for (const Entry &e : row) a.back().push_back(C(e));
+    });
+    int rank = 0;
+    for (int c = 0; c < spec.cols && rank < spec.rows; ++c) {
+      int p = rank;
+      while (p < spec.rows && a[p][c].isZero()) ++p;
+      if (p == spec.rows) continue;
+      swap(a[p], a[rank]);
+      for (int i = rank + 1; i < spec.rows; ++i) {
+        if (a[i][c].isZero()) continue;
+        C f = a[i][c] / a[rank][c];
+        for (int j = c; j < spec.cols; ++j) a[i][j] -= f * a[rank][j];
+      }
+      ++rank;
+    }
+    cout << (rank == spec.rank ? "PASS" : "FAIL") << ": gen matrix " << spec.rows << " " << spec.cols
+         << " --rank=" << spec.rank << " --density=" << spec.density << " has rank " << rank << endl;
+  }
+}
+
 int main() {
   cout << "Testing BigInt" << endl;
   assert_equals(BigInt(65536) * BigInt(65536), BigInt(string("4294967296")));
   assert_equals(BigInt(4294967296L), BigInt(string("4294967296")));
   assert_equals(BigInt(4294967295L), BigInt(string("4294967295")));
+  assert_equals(BigInt(string("340282366920938463463374607431768211455")) / BigInt(string("18446744073709551615")),
+                BigInt(string("18446744073709551617")));
 
   cout << "Testing Fenwick<long long>" << endl;
-  test_fenwick<long long>();
+  test_fenwick<Fenwick, long long>();
 
   cout << "Testing Fenwick<BigInt>" << endl;
-  test_fenwick<BigInt>();
+  test_fenwick<Fenwick, BigInt>();
+
+  cout << "Testing RangeFenwick" << endl;
+  test_range_fenwick<long long>();
+  test_range_fenwick<BigInt>();
+
+  cout << "Testing FenwickND" << endl;
+  test_fenwick_nd<2>({17, 33});
+  test_fenwick_nd<3>({5, 9, 12});
+  {
+    FenwickND<BigInt, 2> grid({3, 4});
+    grid.add({1, 2}, BigInt(string("100000000000000000000")));
+    grid.add({2, 3}, BigInt(7));
+    assert_equals(grid.get({0, 0}, {2, 3}), BigInt(string("100000000000000000007")));
+    assert_equals(grid.get({2, 0}, {2, 3}), BigInt(7));
+  }
+
+  cout << "Testing WideFenwick<long long>" << endl;
+  test_fenwick<WideFenwick, long long>();
+  test_wide_fenwick_sizes();
+
+  cout << "Testing Fenwick::lower_bound" << endl;
+  test_fenwick_lower_bound<int>();
+  test_fenwick_lower_bound<int64_t>();
+  {
+    Fenwick<long long, int64_t> wide_index(100000);
+    const int64_t index[] = {3, 99999, 3};
+    const long long delta[] = {5, 7, 1};
+    wide_index.add_many(index, delta, 3);
+    long long out;
+    const int64_t left = 0, right = 99999;
+    wide_index.get_many(&left, &right, &out, 1);
+    cout << (out == 13 && wide_index.lower_bound(7) == 99999 ? "PASS" : "FAIL") << ": Fenwick<long long, int64_t>" << endl;
+    Fenwick<BigInt> big(10);
+    big.add(4, BigInt(string("100000000000000000000")));
+    cout << (big.lower_bound(BigInt(1)) == 4 && big.lower_bound(BigInt(string("100000000000000000001"))) == 10 ? "PASS" : "FAIL")
+         << ": Fenwick<BigInt>::lower_bound" << endl;
+  }
+
+  cout << "Testing Fenwick on MappedStorage" << endl;
+  test_mapped_fenwick();
+
+  cout << "Testing concurrent Fenwick" << endl;
+  {
+    ConcurrentFenwick<long long> atomic_tree(100000);
+    test_concurrent_fenwick(atomic_tree, "ConcurrentFenwick");
+    ShardedFenwick<long long> sharded(100000, 3);
+    test_concurrent_fenwick(sharded, "ShardedFenwick");
+    ConcurrentFenwick<double> real(10);
+    real.add(0, 0.5);
+    real.add(9, 0.25);
+    cout << (real.get(0, 9) == 0.75 ? "PASS" : "FAIL") << ": ConcurrentFenwick<double>" << endl;
+  }
+
+  cout << "Testing bulk Fenwick" << endl;
+  test_fenwick_bulk<long long>();
+  test_fenwick_bulk<BigInt>();
+
+  cout << "Testing WideFenwick<BigInt>" << endl;
+  test_fenwick<WideFenwick, BigInt>();
 
   cout << "Testing BigInt::sqrt" << endl;
   test_sqrt();
+
+  cout << "Testing Rational<int64_t>" << endl;
+  test_rational<int64_t>();
+
+  cout << "Testing Rational<__int128>" << endl;
+  test_rational<__int128>();
+
+  cout << "Testing Rational<BigInt>" << endl;
+  test_rational<BigInt>();
+  test_rational_width();
+  test_rational_overflow();
+
+  cout << "Testing int_gcd" << endl;
+  test_gcd();
+
+  cout << "Testing RandomGenerator" << endl;
+  test_random();
+
+  cout << "Testing FastInput and FastOutput" << endl;
+  test_fastio();
+
+  cout << "Testing Complex" << endl;
+  test_complex();
+
+  cout << "Testing gen" << endl;
+  test_gen();
   return 0;
 }
@@ -23,6 +23,8 @@ TASK:
 #include <utility>
 #include <vector>
 
+#include "fastio.h"
+
 using namespace std;
 
 #ifdef _DEBUG_MODE_
@@ -64,6 +66,7 @@ int main() {
   _main();
   // COUNTER CODE ENDS HERE
 
+  fast_out.flush();
 #ifndef _DEBUG_MODE_
   fclose(stdin); fclose(stdout);
 #endif